@@ -0,0 +1,38 @@
+#version 330 core
+
+in vec3 vWorldPos;
+in vec3 vBaseColor;
+flat in vec3 vCenter;
+flat in float vRadius;
+
+out vec4 FragColor;
+
+uniform mat4 uVP;
+uniform vec3 uLightDir;
+uniform vec3 uCamPos;
+
+void main()
+{
+    //Eye ray against the exact sphere. The miss test uses the ray's closest approach to the centre, not
+    //b * b - c: far away both terms are huge and their difference loses the silhouette.
+    vec3 dir = normalize(vWorldPos - uCamPos);
+    vec3 oc = uCamPos - vCenter;
+    float b = dot(oc, dir);
+    vec3 closest = oc - b * dir;
+    float h = vRadius * vRadius - dot(closest, closest);
+    if (h < 0.0) discard;
+
+    vec3 hit = uCamPos + dir * (-b - sqrt(h));
+    vec4 clip = uVP * vec4(hit, 1.0);
+    gl_FragDepth = 0.5 * (gl_DepthRange.diff * clip.z / clip.w + gl_DepthRange.near + gl_DepthRange.far);
+
+    //Same lighting as instanced.frag.
+    vec3 N = (hit - vCenter) / vRadius;
+    vec3 L = normalize(uLightDir);
+
+    float NdotL = max(dot(N, L), 0.0);
+    vec3 ambient = 0.15 * vBaseColor;
+    vec3 diffuse = NdotL * vBaseColor;
+
+    FragColor = vec4(ambient + diffuse, 1.0);
+}
\ No newline at end of file
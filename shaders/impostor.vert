@@ -0,0 +1,37 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;           //Quad corner, xy in [-1, 1]
+
+layout (location = 2) in vec3  iPos;          //float3
+layout (location = 3) in float iScale;        //half -> promoted to float
+layout (location = 4) in vec4  iColorUNorm;   //UNORM8x4 normalized
+layout (location = 5) in float iAngle;        //half -> float
+
+uniform mat4 uVP;
+uniform vec3 uCamPos;
+
+out vec3 vWorldPos;
+out vec3 vBaseColor;
+flat out vec3 vCenter;
+flat out float vRadius;
+
+void main()
+{
+    //Quad through the centre, facing the eye, as large as the cone of rays that touch the sphere is there:
+    //every pixel of the silhouette gets a fragment.
+    vec3 toEye = uCamPos - iPos;
+    float dist = length(toEye);
+    vec3 forward = toEye / dist;
+    vec3 right = normalize(cross(abs(forward.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0), forward));
+    vec3 up = cross(forward, right);
+    float halfSize = iScale * dist / sqrt(max(dist * dist - iScale * iScale, 1e-6));
+
+    vec3 world = iPos + (right * aPos.x + up * aPos.y) * halfSize;
+
+    vWorldPos  = world;
+    vBaseColor = iColorUNorm.rgb;
+    vCenter    = iPos;
+    vRadius    = iScale;
+
+    gl_Position = uVP * vec4(world, 1.0);
+}
\ No newline at end of file
@@ -9,6 +9,17 @@
 #include <thread>
 #include <atomic>
 #include <memory>
+#include <chrono>
+
+namespace
+{
+    using FrameClock = std::chrono::steady_clock;
+
+    inline double msSince(FrameClock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(FrameClock::now() - start).count();
+    }
+}
 
 int App::cachedW = 0;
 int App::cachedH = 0;
@@ -16,7 +27,8 @@ int App::cachedH = 0;
 App::App()
     : instancedShader(ShaderLoader::fromFiles("shaders/instanced.vert", "shaders/instanced.frag"))
     , wireShader(ShaderLoader::fromFiles("shaders/box.vert", "shaders/box.frag"))
-    , instance(SPHERE_XSEGS, SPHERE_YSEGS, INSTANCE_COUNT)
+    , impostorShader(ShaderLoader::fromFiles("shaders/impostor.vert", "shaders/impostor.frag"))
+    , instance(SPHERE_SUBDIVISIONS, INSTANCE_COUNT)
 {
     glEnable(GL_DEPTH_TEST);            //Depth test on for proper 3D visibility.
     glEnable(GL_CULL_FACE);             //Back-face culling to save fillrate.
@@ -28,56 +40,26 @@ App::App()
     const glm::vec3 BOX_MIN(-40.f, -20.f, -45.f);
     const glm::vec3 BOX_MAX(40.f, 20.f, 45.f);
 
-    grid.resize(BOX_MIN, BOX_MAX, sphereRadius * 2.0f); //Cell size is around the same as diameter for good neighborhood locality.
-
-    glLineWidth(1.5f);
-
-    //--STRATIFIED-SPAWN--
-    spheres.reserve(N); //Reserve upfront to avoid reallocation churn.
-
-    const int side = static_cast<int>(std::ceil(std::cbrt(static_cast<double>(N))));
-    const glm::vec3 boxSize = BOX_MAX - BOX_MIN;
-    const glm::vec3 cell = boxSize / static_cast<float>(side);
-    const glm::vec3 clampMin = BOX_MIN + glm::vec3(sphereRadius);
-    const glm::vec3 clampMax = BOX_MAX - glm::vec3(sphereRadius);
+    const float maxRadius = sphereRadius * RADIUS_SPREAD;
 
-    spawnRNG frng(0xC001CAFEu);
-    int placed = 0;
+    physics.dt = 1.0f / PHYSICS_HZ;
+    physics.configure(BOX_MIN, BOX_MAX, sphereRadius, maxRadius, DETERMINISTIC_PHYSICS); //Grids, hierarchical levels, speculative margins.
 
-    for (int z = 0; z < side && placed < N; ++z)
-    {
-        for (int y = 0; y < side && placed < N; ++y)
-        {
-            for (int x = 0; x < side && placed < N; ++x)
-            {
-                glm::vec3 base = BOX_MIN + (glm::vec3(x, y, z) + glm::vec3(0.5f)) * cell; //Center of grid cell.
-                glm::vec3 jitter = (frng.f3() - glm::vec3(0.5f)) * (cell - glm::vec3(sphereRadius * 2.0f)); //Small random offset inside cell.
-                glm::vec3 pos = glm::clamp(base + jitter, clampMin, clampMax); //Clamp to avoid spawning intersecting the walls.
+    glLineWidth(1.5f);
 
-                spheres.emplace_back(SPHERE_XSEGS, SPHERE_YSEGS, pos, sphereRadius);
-                ++placed;
-            }
-        }
-    }
-    //--STRATIFIED-SPAWN-END--
+    spawnStratified(particles, N, BOX_MIN, BOX_MAX, sphereRadius, RADIUS_SPREAD, 0xC001CAFEu); //Same seed, same scene as the headless benchmark.
+    physics.prime(threads, particles); //Per-sphere locks + broadphase for the first frame.
 
-    //--LOCKS-INIT--
-    sphereLocks.reset(new SphereLock[N]); //Allocate per-sphere locks once.
-    //--LOCKS-INIT-END--
+    renderSnapshot.simdLevel = physics.simdLevel; //FORCE_SCALAR_KERNELS reaches the snapshot's kernels too.
+    renderSnapshot.publish(threads, particles, nullptr);
+    renderSnapshot.flip(); //First frame draws the spawn state.
 
-    //--GRID-WARMUP--
-    grid.clear(N);
-
-    for (int i = 0; i < N; ++i)
-    {
-        grid.insert(i, spheres[i].getPosition(), spheres[i].getScale()); //Prime broadphase grid for first frame.
-    }
-    //--GRID-WARMUP-END--
-
-    instance.updateInstances(spheres, N, 0.0f); //Upload initial instance data to the GPU.
+    instance.updateInstances(particles, N, 0.0f); //Upload initial instance data to the GPU.
 
     instancedShader.use();
     instancedShader.setVec3("uLightDir", lightDir); //Static lighting direction for simple shading.
+    impostorShader.use();
+    impostorShader.setVec3("uLightDir", lightDir); //Same light as the meshes.
     visibleIndices.resize(N); //Pre-size visibility buffer to worst case.
 
     wireShader.use();
@@ -108,212 +90,400 @@ int App::run()
     {
         while (!window.shouldClose())
         {
+#if PROFILING
+            Profiler::endFrame(); //Fold last frame's scopes into the HUD averages before this one opens.
+#endif
+            PROFILE_SCOPE("frame");
+
             if (glfwGetKey(window.handle(), GLFW_KEY_ESCAPE) == GLFW_PRESS)
             {
                 window.requestClose();
             }
 
-            //--CAMERA-UPDATE-STAGE--
-            const double now = glfwGetTime();                                   //Frame time in seconds.
-            const float dt = static_cast<float>(now - lastFrameTime);           //Delta time for this frame.
-            lastFrameTime = now;
-            camera.update(window.handle(), dt);                                 //Mouse + keyboard camera control.
-            //--CAMERA-UPDATE-STAGE-END--
-
 #if PHYSICS
-            //--PHYSICS-UPDATE-STAGE--
-            physicsAccumulator += dt;                                           //Fixed-step accumulator.
-            int steps = 0;
-            const int MAX_STEPS = 4;                                            //Clamp to avoid spiral-of-death under load.
+            //--SOLVER-TOGGLE--
+            {
+                static bool wasDown = false;
+                const bool down = glfwGetKey(window.handle(), GLFW_KEY_L) == GLFW_PRESS;
+                if (down && !wasDown)
+                {
+                    const int modeCount = DETERMINISTIC_PHYSICS ? 2 : 3; //Spinlock resolve order follows lock races, skip it.
+                    physics.solverMode = static_cast<SolverMode>((static_cast<int>(physics.solverMode) + 1) % modeCount); //L cycles solver modes for comparison.
+                }
+                wasDown = down;
+            }
+            //--SOLVER-TOGGLE-END--
 
-            while (physicsAccumulator >= physicsDt && steps < MAX_STEPS)
+            //--BROADPHASE-TOGGLE--
             {
-                //--APPLY-GRAVITY-- (parallel)
-                threads.parallelFor(0, N, 2048, [&](int i0, int i1, int /*k*/)
+                static bool wasDown = false;
+                const bool down = glfwGetKey(window.handle(), GLFW_KEY_B) == GLFW_PRESS;
+                if (down && !wasDown)
                 {
-                    for (int i = i0; i < i1; ++i)
-                        spheres[i].applyGravity(gravity, physicsDt);            //Simple Euler integration.
-                });
-                //--APPLY-GRAVITY-END--
+                    physics.broadphaseMode = static_cast<BroadphaseMode>((static_cast<int>(physics.broadphaseMode) + 1) % 3); //B cycles pair sources.
+                }
+                wasDown = down;
+            }
+            //--BROADPHASE-TOGGLE-END--
+#endif
 
-                //--WALL-COLLISIONS-- (parallel)
-                threads.parallelFor(0, N, 2048, [&](int i0, int i1, int /*k*/)
+#if PROFILING
+            //--TRACE-DUMP--
+            {
+                static bool wasDown = false;
+                const bool down = glfwGetKey(window.handle(), GLFW_KEY_P) == GLFW_PRESS;
+                if (down && !wasDown)
                 {
-                    for (int i = i0; i < i1; ++i)
-                        cage.resolveCollision(spheres[i], restitutionWall);     //Cheap AABB boundary bounce.
-                });
-                //--WALL-COLLISIONS-END--
-
-                //--GRID-REBUILD-- (sequential; internal datastructures not thread-safe)
-                grid.clear(N);                                                          //Sparse reset (touch list) to keep O(active).
-                for (int i = 0; i < N; ++i)
+                    const bool ok = Profiler::writeChromeTrace("trace.json"); //P dumps the recent frames for chrome://tracing or Perfetto.
+                    std::cout << (ok ? "Wrote trace.json\n" : "Could not write trace.json\n");
+                }
+                wasDown = down;
+            }
+            //--TRACE-DUMP-END--
+#endif
+
+            //--GOVERNOR-TOGGLE--
+            {
+                static bool wasDown = false;
+                const bool down = glfwGetKey(window.handle(), GLFW_KEY_G) == GLFW_PRESS;
+                if (down && !wasDown)
                 {
-                    grid.insert(i, spheres[i].getPosition(), spheres[i].getScale());    //Broadphase buckets.
+                    governor.enabled = !governor.enabled; //G compares governed and full-quality frames.
                 }
-                //--GRID-REBUILD-END--
+                wasDown = down;
+            }
+            //--GOVERNOR-TOGGLE-END--
 
-                //--SPHERE-SPHERE-COLLISIONS-- (broadphase parallel, ordered spinlocks in narrowphase)
-                for (int iter = 0; iter < 2; ++iter)                                    //Two solver passes to reduce jitter.
+            //--OCCLUSION-TOGGLE--
+            {
+                static bool wasDown = false;
+                const bool down = glfwGetKey(window.handle(), GLFW_KEY_O) == GLFW_PRESS;
+                if (down && !wasDown)
                 {
-                    grid.forEachPotentialPairPrunedParallel
-                    (
-                        threads,
-                        [&](int id) -> const glm::vec3& { return spheres[id].getPosition(); },
-                        [&](int id) -> float { return spheres[id].getScale();     },
-                        [&](int a, int b)
-                        {
-                            int i = a, j = b;
-                            if (i > j) std::swap(i, j); //Order locks to avoid deadlock.
-
-                            sphereLocks[i].lock();
-                            sphereLocks[j].lock();
-                            spheres[a].collide(spheres[b], restitutionSphere); //Narrow-phase resolve.
-                            sphereLocks[j].unlock();
-                            sphereLocks[i].unlock();
-                        }
-                    );
+                    occlusionCulling = !occlusionCulling; //O compares frustum-only and occlusion-culled frames.
                 }
-                //--SPHERE-SPHERE-COLLISIONS-END--
+                wasDown = down;
+            }
+            //--OCCLUSION-TOGGLE-END--
 
-                physicsAccumulator -= physicsDt;
-                ++steps;
+            //--IMPOSTOR-TOGGLE--
+            {
+                static bool wasDown = false;
+                const bool down = glfwGetKey(window.handle(), GLFW_KEY_I) == GLFW_PRESS;
+                if (down && !wasDown)
+                {
+                    impostors = !impostors; //I compares impostors and meshes for the smallest spheres.
+                }
+                wasDown = down;
             }
+            //--IMPOSTOR-TOGGLE-END--
 
-            const double maxCarry = physicsDt * MAX_STEPS; //Cap the leftover time so we dont accumulate too much lag.
-            if (physicsAccumulator > maxCarry) physicsAccumulator = maxCarry;
-            //--PHYSICS-UPDATE-STAGE-END--
-#endif
-            int w, h;
-            window.getFramebufferSize(w, h);
+            const double now = glfwGetTime();                                   //Frame time in seconds.
+            const float dt = static_cast<float>(now - lastFrameTime);           //Delta time for this frame.
+            lastFrameTime = now;
 
-            if (w != cachedW || h != cachedH)
+            //--FPS-UPDATE-STAGE--
             {
-                glViewport(0, 0, w, h); //Only touch viewport when it changes.
-                cachedW = w; cachedH = h;
+                static double accTime = 0.0;
+                static unsigned int accFrames = 0;
+                static const double UPDATE_SECS = 1.0; //Update FPS once per second for stability.
+
+                accTime += (double)dt;
+                accFrames += 1;
+
+                if (accTime >= UPDATE_SECS)
+                {
+                    fps = (accFrames > 0) ? (double(accFrames) / accTime) : 0.0;
+                    accTime -= UPDATE_SECS;
+                    accFrames = 0;
+                }
             }
+            //--FPS-UPDATE-STAGE-END--
+
+            int w, h;
+            window.getFramebufferSize(w, h);
 
-            glClearColor(0.08f, 0.10f, 0.12f, 1.0f); //Dark slate background.
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glm::mat4 vp(1.0f);         //Written by the view stage.
+            FrustumPlane frustum[6];
+            glm::vec3 eye(0.0f);
+            float pixelsPerUnit = 1.0f; //Projected radius in pixels of a unit sphere at distance 1.
 
-            //--PROJECTION-CACHE--
-            static int lastW = -1, lastH = -1;
-            static float lastFov = -1.0f;
-            static glm::mat4 cachedProj(1.0f);
+            const GovernorSettings quality = governor.getSettings(); //Chosen from last frame's costs.
+            FrameCosts costs;
+            costs.intervalMs = dt * 1000.0;
 
-            const float fovNow = camera.getFOV();
-            if (w != lastW || h != lastH || fovNow != lastFov)
+            //--CAMERA-UPDATE-STAGE--
+            auto cameraStage = [&]
             {
-                cachedProj = glm::perspective(glm::radians(fovNow), (float)w / (float)h, 0.5f, 200.0f); //Only recompute when inputs change.
-                lastW = w; lastH = h; lastFov = fovNow;
-            }
-            const glm::mat4 proj = cachedProj; //Cheap copy from static cache.
-            //--PROJECTION-CACHE-END--
+                camera.update(window.handle(), dt);                             //Mouse + keyboard camera control.
+            };
+            //--CAMERA-UPDATE-STAGE-END--
 
-            const glm::mat4 view = camera.viewMatrix();
-            const glm::mat4 vp = proj * view; //Combined clip transform.
+#if PHYSICS
+            //--PHYSICS-UPDATE-STAGE--
+            auto physicsStage = [&]
+            {
+                physicsAccumulator += dt;                                       //Fixed-step accumulator.
+                const int MAX_STEPS = quality.maxSubsteps;                      //Governor cap: above it the simulation slows down, not the frame.
+                const int steps = std::min(MAX_STEPS, static_cast<int>(physicsAccumulator / physics.dt));
 
-            //--FRUSTUM-BUILD-STAGE--
-            FrustumPlane frustum[6];
-            extractFrustumPlanes(vp, frustum); //Build 6 planes for culling.
-            //--FRUSTUM-BUILD-STAGE-END--
+                physics.solverIterations = quality.solverIterations;
+                costs.substeps = steps;
+                costs.solverIterations = quality.solverIterations;
 
-            //--INSTANCED-SPHERE-DRAWING-STAGE--
-            instancedShader.use();
-            instancedShader.setMat4("uVP", vp);
-            instancedShader.setVec3("uCamPos", camera.getPosition());
-            instancedShader.setFloat("uTime", static_cast<float>(now));
+                for (int s = 0; s < steps; ++s)
+                {
+                    if (s == steps - 1) renderSnapshot.capturePrevious(threads, particles); //Interpolation starts from the state before the newest step.
+                    physics.step(threads, particles);                            //Reorder, integrate, broadphase, contacts, sleep.
 
-            //--VISIBILITY-CULL--
-            if ((int)visibleIndices.size() < N) visibleIndices.resize(N); //Ensure space for worst case.
+                    costs.physicsMs += physics.getTimings().total;
+                    costs.solveMs += physics.getTimings().contactSolve;
+                    physicsAccumulator -= physics.dt;
+                }
 
-            const int total = N;
-            const int minGrain = 4096; //Chunk size tuned for cache and scheduling overhead.
-            const int tcount = threads.getThreadCount();
-            const int chunks = std::max(1, std::min(tcount, total / std::max(1, minGrain)));
+                const double maxCarry = physics.dt * MAX_STEPS; //Cap the leftover time so we dont accumulate too much lag.
+                if (physicsAccumulator > maxCarry) physicsAccumulator = maxCarry;
 
-            static std::vector<int> counts;
-            counts.assign(chunks, 0); //Per-chunk visible counts.
+                if (steps > 0) renderSnapshot.publish(threads, particles, physics.getLastPermutation()); //Into the back state: this frame's cull and upload still read the front.
+                renderSnapshot.setAlpha(static_cast<float>(std::min(1.0, physicsAccumulator / physics.dt))); //Leftover time blends the two newest steps.
+            };
+            //--PHYSICS-UPDATE-STAGE-END--
+#endif
 
-            threads.parallelFor(0, total, minGrain, [&](int i0, int i1, int k)
+            //--FRUSTUM-BUILD-STAGE--
+            auto viewStage = [&]
             {
-                int c = 0;
+                //--PROJECTION-CACHE--
+                static int lastW = -1, lastH = -1;
+                static float lastFov = -1.0f;
+                static glm::mat4 cachedProj(1.0f);
 
-                for (int i = i0; i < i1; ++i)
+                const float fovNow = camera.getFOV();
+                if (w != lastW || h != lastH || fovNow != lastFov)
                 {
-                    const glm::vec3 cpos = spheres[i].getPosition();
-                    const float rad = spheres[i].getScale();
-                    c += sphereIntersectsFrustum(frustum, cpos, rad) ? 1 : 0; //Only test sphere vs frustum (cheap).
+                    cachedProj = glm::perspective(glm::radians(fovNow), (float)w / (float)h, 0.5f, 200.0f); //Only recompute when inputs change.
+                    lastW = w; lastH = h; lastFov = fovNow;
                 }
+                const glm::mat4 proj = cachedProj; //Cheap copy from static cache.
+                //--PROJECTION-CACHE-END--
 
-                counts[k] = c;
-            });
+                const glm::mat4 view = camera.viewMatrix();
+                vp = proj * view; //Combined clip transform.
 
-            static std::vector<int> offsets;
-            offsets.assign(chunks + 1, 0); //Exclusive prefix sum for scatter.
+                eye = camera.getPosition();
+                pixelsPerUnit = 0.5f * (float)h / std::tan(glm::radians(fovNow) * 0.5f);
+
+                extractFrustumPlanes(vp, frustum); //Build 6 planes for culling.
+            };
+            //--FRUSTUM-BUILD-STAGE-END--
 
-            for (int k = 0; k < chunks; ++k)
+            //--BOX-DRAWING-STAGE-- (clear and cage first: main-thread GL that does not need this frame's physics)
+            auto clearStage = [&]
             {
-                offsets[k + 1] = offsets[k] + counts[k];
-            }
+                if (w != cachedW || h != cachedH)
+                {
+                    glViewport(0, 0, w, h); //Only touch viewport when it changes.
+                    cachedW = w; cachedH = h;
+                }
 
-            threads.parallelFor(0, total, minGrain, [&](int i0, int i1, int k)
+                glClearColor(0.08f, 0.10f, 0.12f, 1.0f); //Dark slate background.
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+                wireShader.use();
+                wireShader.setMat4("uMVP", vp);
+                cage.draw(); //Outline the simulation bounds.
+            };
+            //--BOX-DRAWING-STAGE-END--
+
+            //--INSTANCED-SPHERE-DRAWING-STAGE--
+            //--VISIBILITY-CULL--
+            auto cullStage = [&]
             {
-                int out = offsets[k];
+                const FrameClock::time_point start = FrameClock::now();
+                const RenderState& state = renderSnapshot.front();
+
+                //Frustum test, then the governor's detail cull: radius * pixelsPerUnit / distance < minPixelRadius
+                //is dropped. Squared on both sides, so no sqrt; minPixelRadius 0 keeps everything.
+                CullParams params;
+                std::copy(frustum, frustum + 6, params.planes);
+                params.eye = eye;
+                const float minRatio = quality.minPixelRadius / pixelsPerUnit;
+                params.minRatio2 = minRatio * minRatio;
 
-                for (int i = i0; i < i1; ++i)
+                const CullStreams spheres = state.cullStreams(); //Blended like getPosition(): cull what gets drawn.
+
+                if ((int)frustumIndices.size() < state.count) frustumIndices.resize(state.count); //Ensure space for worst case.
+                if ((int)visibleIndices.size() < state.count) visibleIndices.resize(state.count);
+                visibleMask.resize(static_cast<size_t>((state.count + 63) >> 6));
+
+                auto fillMask = [&](int w0, int w1) //A chunk's 64-sphere words: block test first, kernel only where it straddles.
                 {
-                    const glm::vec3 cpos = spheres[i].getPosition();
-                    const float     rad = spheres[i].getScale();
+                    cullSpheresBlocked(spheres, state.blocks.data(), w0 << 6, std::min(state.count, w1 << 6), params, visibleMask.data(), physics.simdLevel);
+                };
 
-                    if (sphereIntersectsFrustum(frustum, cpos, rad))
-                    {
-                        visibleIndices[out++] = i; //Scatter visible indices compactly.
-                    }
+                const int minGrain = 4096; //Chunk size tuned for cache and scheduling overhead.
+                frustumCount = parallelCompactBits(threads, cullScratch, state.count, minGrain, fillMask, visibleMask.data(), frustumIndices.data()); //Ascending ids.
+                costs.renderMs += msSince(start);
+            };
+            //--VISIBILITY-CULL-END--
+
+            //--OCCLUSION-CULL-- (frustum survivors against a Hi-Z of the biggest ones; off, the list passes through)
+            auto occlusionStage = [&]
+            {
+                const FrameClock::time_point start = FrameClock::now();
+
+                if (occlusionCulling && quality.occlusionCulling) //O, and the governor skips it when render has no headroom.
+                {
+                    lastVisibleCount = occlusion.cull(threads, renderSnapshot.front().cullStreams(), frustumIndices.data(), frustumCount,
+                                                      vp, eye, w, h, visibleIndices.data(), physics.simdLevel); //Still ascending.
+                    costs.occlusionMs = msSince(start);
+                }
+                else
+                {
+                    std::swap(frustumIndices, visibleIndices); //Both were sized to the snapshot by the cull.
+                    lastVisibleCount = frustumCount;
                 }
-            });
 
-            lastVisibleCount = offsets.back();      //Total visible after prefix sum.
-            //--VISIBILITY-CULL-END--
+                costs.renderMs += msSince(start);
+            };
+            //--OCCLUSION-CULL-END--
 
-            instance.updateInstancesFiltered(spheres, visibleIndices, lastVisibleCount, static_cast<float>(now)); //Upload only visible instances.
-            instance.draw(lastVisibleCount);        //Instanced draw, amortizes vertex work on GPU.
-            //--INSTANCED-SPHERE-DRAWING-STAGE-END--
+            //--LOD-BINNING-- (visible list regrouped into per-LOD ranges by projected radius, ascending within each; impostors last)
+            auto lodStage = [&]
+            {
+                const FrameClock::time_point start = FrameClock::now();
 
-            //--BOX-DRAWING-STAGE--
-            wireShader.use();
-            wireShader.setMat4("uMVP", vp);
-            cage.draw(); //Outline the simulation bounds.
-            //--BOX-DRAWING-STAGE-END--
+                for (int l = 0; l < instance.getLodCount(); ++l) lodMaxRadius[l] = instance.getLodMaxRadius(l, quality.lodErrorPx); //Governor knob.
+                lodMaxRadius[instance.getLodCount()] = IMPOSTOR_MAX_RADIUS_PX;
 
-            //--FPS-UPDATE-STAGE--
+                lodBinner.bin(threads, renderSnapshot.front().cullStreams(), visibleIndices.data(), lastVisibleCount, eye, pixelsPerUnit,
+                              lodMaxRadius, instance.getLodCount() + (impostors ? 1 : 0), frustumIndices.data(), lodRanges);
+                std::swap(frustumIndices, visibleIndices); //The frustum list is spent by now: binned into it, then swapped in.
+
+                costs.renderMs += msSince(start);
+            };
+            //--LOD-BINNING-END--
+
+            auto uploadStage = [&]
             {
-                static double accTime = 0.0;
-                static unsigned int accFrames = 0;
-                static const double UPDATE_SECS = 1.0; //Update FPS once per second for stability.
+                const FrameClock::time_point start = FrameClock::now();
+                instance.updateInstancesFiltered(renderSnapshot.front(), visibleIndices, lastVisibleCount, static_cast<float>(now)); //Upload only visible instances.
+                costs.renderMs += msSince(start);
+            };
 
-                accTime += (double)dt;
-                accFrames += 1;
+            auto drawStage = [&]
+            {
+                const FrameClock::time_point start = FrameClock::now();
+                instancedShader.use();
+                instancedShader.setMat4("uVP", vp);
+                instancedShader.setVec3("uCamPos", camera.getPosition());
+                instancedShader.setFloat("uTime", static_cast<float>(now));
+
+                instance.draw(lodRanges);           //One instanced draw per LOD, amortizes vertex work on GPU.
+
+                impostorShader.use();
+                impostorShader.setMat4("uVP", vp);
+                impostorShader.setVec3("uCamPos", camera.getPosition());
+                instance.drawImpostors(lodRanges);  //Two triangles per far sphere, exact silhouette and depth.
+                costs.renderMs += msSince(start);
+            };
+            //--INSTANCED-SPHERE-DRAWING-STAGE-END--
 
-                if (accTime >= UPDATE_SECS)
+            auto hudStage = [&]
+            {
+                char line1[64], line3[160], budget[128];
+                std::snprintf(line1, sizeof(line1), "FPS %d", (int)std::round(fps));
+
+                int n = std::snprintf(line3, sizeof(line3), "VIS %d  HIDDEN %d  %s  LOD", lastVisibleCount, frustumCount - lastVisibleCount,
+                                      !occlusionCulling ? "OCC OFF" : quality.occlusionCulling ? "OCC ON" : "OCC SKIP");
+                long long triangles = 0;
+                const int meshRanges = std::min(lodRanges.rangeCount, instance.getLodCount());
+                for (int l = 0; l < meshRanges; ++l) //Instances per LOD, finest first, then impostors and the triangles they all submit.
                 {
-                    fps = (accFrames > 0) ? (double(accFrames) / accTime) : 0.0;
-                    accTime -= UPDATE_SECS;
-                    accFrames = 0;
+                    n += std::snprintf(line3 + n, sizeof(line3) - n, "%s%d", l ? "/" : " ", lodRanges.count[l]);
+                    triangles += (long long)lodRanges.count[l] * instance.getLodTriangles(l);
                 }
-            }
+                if (lodRanges.rangeCount > meshRanges)
+                {
+                    n += std::snprintf(line3 + n, sizeof(line3) - n, "  IMP %d", lodRanges.count[meshRanges]);
+                    triangles += (long long)lodRanges.count[meshRanges] * instance.getImpostorTriangles();
+                }
+                std::snprintf(line3 + n, sizeof(line3) - n, "  TRIS %.2fM", triangles * 1e-6);
+
+                //--GOVERNOR-READOUT-- (budget, smoothed headroom and the knobs this frame ran with)
+                std::snprintf(budget, sizeof(budget), "BUDGET %.1f MS  HEAD %.2f  %s  ITER %d  STEPS %d  MINPX %.1f  LODPX %.1f",
+                              governor.getTargetMs(), governor.getHeadroomMs(), governor.enabled ? "GOV ON" : "GOV OFF",
+                              quality.solverIterations, quality.maxSubsteps, quality.minPixelRadius, quality.lodErrorPx);
+                //--GOVERNOR-READOUT-END--
+
+#if PROFILING
+                //--PROFILER-READOUT-- (rolling ms per frame, stages overlap; workers: busy time range and slowest/average chunk)
+                char stages[192], physicsStages[128], workers[128];
+                std::snprintf(stages, sizeof(stages), "CPU MS  CAM %.2f  VIEW %.2f  PHYS %.2f  CLR %.2f  CULL %.2f  OCC %.2f  LOD %.2f  UPLD %.2f  DRAW %.2f  HUD %.2f",
+                              Profiler::getAverageMs("camera"), Profiler::getAverageMs("view"), Profiler::getAverageMs("physics"),
+                              Profiler::getAverageMs("clear"), Profiler::getAverageMs("cull"),
+                              Profiler::getAverageMs("occlusion"), Profiler::getAverageMs("lod"),
+                              Profiler::getAverageMs("upload"), Profiler::getAverageMs("draw"), Profiler::getAverageMs("hud"));
+                std::snprintf(physicsStages, sizeof(physicsStages), "PHYS MS  INT %.2f  BP %.2f  NP %.2f  SLEEP %.2f",
+                              Profiler::getAverageMs("integrate"), Profiler::getAverageMs("broadphase"),
+                              Profiler::getAverageMs("narrowphase"), Profiler::getAverageMs("sleep"));
+
+                const int workerCount = Profiler::getWorkerCount();
+                double busyMin = workerCount ? 1e30 : 0.0, busyMax = 0.0;
+                for (int k = 0; k < workerCount; ++k)
+                {
+                    const double busy = Profiler::getWorkerBusyMs(k);
+                    busyMin = std::min(busyMin, busy);
+                    busyMax = std::max(busyMax, busy);
+                }
+                std::snprintf(workers, sizeof(workers), "WORKERS %d  BUSY %.2f-%.2f MS  IMB %.2f",
+                              workerCount, busyMin, busyMax, Profiler::getImbalance());
+
+                const char* lines[6] = { line1, budget, stages, physicsStages, workers, line3 };
+                hud.draw(w, h, lines, 6); //FPS, governor, stage breakdown, worker imbalance, visible count. P writes trace.json.
+                //--PROFILER-READOUT-END--
+#else
+                hud.draw(w, h, line1, budget, line3); //Minimal HUD: FPS, governor and visible count.
+#endif
+            };
 
-            {
-                char line1[64], line3[64];
-                std::snprintf(line1, sizeof(line1), "FPS %d", (int)std::round(fps));
-                std::snprintf(line3, sizeof(line3), "VIS %d", lastVisibleCount);
+            //--FRAME-GRAPH-- (edges come from the resources; GL and input stay on this thread, physics goes to a lane)
+            //Render stages read the snapshot physics published last frame, so physics for the next state runs
+            //next to cull, upload and draw: the frame costs about max(physics, render) instead of the sum.
+            using Affinity = TaskGraph::Affinity;
 
-                hud.draw(w, h, line1, nullptr, line3); //Minimal HUD: FPS and visible count.
-            }
-            //--FPS-UPDATE-STAGE-END--
+            frameGraph.clear();
+#if PHYSICS
+            frameGraph.add("physics", Affinity::PreferWorker, {},                          { FRAME_PARTICLES },                physicsStage);
+#endif
+            frameGraph.add("camera",  Affinity::Main, {},                                 { FRAME_CAMERA },                   cameraStage);
+            frameGraph.add("view",    Affinity::Any,  { FRAME_CAMERA },                   { FRAME_VIEW },                     viewStage);
+            frameGraph.add("clear",   Affinity::Main, { FRAME_VIEW },                     { FRAME_TARGET },                   clearStage);
+            frameGraph.add("cull",    Affinity::Any,  { FRAME_SNAPSHOT, FRAME_VIEW },     { FRAME_VISIBLE },                  cullStage);
+            frameGraph.add("occlusion", Affinity::Any, { FRAME_SNAPSHOT, FRAME_VIEW, FRAME_VISIBLE }, { FRAME_VISIBLE },    occlusionStage);
+            frameGraph.add("lod",     Affinity::Any,  { FRAME_SNAPSHOT, FRAME_VIEW, FRAME_VISIBLE }, { FRAME_VISIBLE },       lodStage);
+            frameGraph.add("upload",  Affinity::Main, { FRAME_SNAPSHOT, FRAME_VISIBLE },  { FRAME_TARGET },                   uploadStage);
+            frameGraph.add("draw",    Affinity::Main, { FRAME_VIEW, FRAME_VISIBLE },      { FRAME_TARGET },                   drawStage);
+            frameGraph.add("hud",     Affinity::Main, { FRAME_VISIBLE },                  { FRAME_TARGET },                   hudStage);
+
+            const FrameClock::time_point graphStart = FrameClock::now();
+            frameGraph.run(threads); //Physics overlaps every other stage.
+            costs.graphMs = msSince(graphStart);
+
+            renderSnapshot.flip();   //Both sides are done: next frame draws what physics just published.
+            governor.observe(costs); //Knobs for the next frame.
+            //--FRAME-GRAPH-END--
 
-            window.swapBuffers();
-            window.pollEvents();
+            {
+                PROFILE_SCOPE("present");
+                window.swapBuffers();
+                window.pollEvents();
+            }
         }
+
+#if PROFILING
+        Profiler::writeChromeTrace("trace.json"); //Last few seconds of the session.
+#endif
     }
     catch (const std::exception& e)
     {
@@ -9,49 +9,29 @@
 #include "../utils/ShaderLoader.h"
 #include "../utils/HUD.h"
 #include "../scene/Box.h"
-#include "../scene/Sphere.h"
+#include "../scene/ParticleStore.h"
+#include "../scene/RenderSnapshot.h"
 #include "../scene/Camera.h"
 #include "../optimization/Instance.h"
 #include "../optimization/Frustum.h"
-#include "../optimization/UniformGrid.h"
+#include "../optimization/SimdCulling.h"
+#include "../optimization/OcclusionCuller.h"
+#include "../optimization/LodBinning.h"
 #include "../optimization/ThreadSystem.h"
+#include "../optimization/TaskGraph.h"
+#include "../optimization/ParallelScan.h"
+#include "PhysicsPipeline.h"
+#include "FrameGovernor.h"
 
 #include <vector>
 #include <string>
+#include <cstdint>
 #include <gtc/matrix_transform.hpp>
 
-//--SPAWN-RNG--
-namespace
-{
-    struct spawnRNG
-    {
-        uint32_t s;
-        explicit spawnRNG(uint32_t seed) : s(seed ? seed : 1u) {}
-        inline uint32_t u32() { s ^= s << 13; s ^= s >> 17; s ^= s << 5; return s; }
-        inline float f01() { return (float)((u32() >> 8) * (1.0 / 16777215.0)); }
-        inline glm::vec3 f3() { return glm::vec3(f01(), f01(), f01()); }
-    };
-}
-//--SPAWN-RNG-END--
-
-//--SPHERE-LOCKS--
-struct SphereLock
-{
-    std::atomic_flag f = ATOMIC_FLAG_INIT;
-    SphereLock() noexcept = default;
-    SphereLock(const SphereLock&) = delete;
-    SphereLock& operator=(const SphereLock&) = delete;
-
-    inline void lock() { while (f.test_and_set(std::memory_order_acquire)) {} }
-    inline void unlock() { f.clear(std::memory_order_release); }
-};
-//--SPHERE-LOCKS-END--
-
 //--THREADS--
 namespace
 {
     ThreadSystem threads(0);                        //Thread pool used for CPU-parallel stages.
-    std::unique_ptr<SphereLock[]> sphereLocks;      //One spinlock per sphere for ordered narrow-phase locking.
 }
 //--THREADS-END--
 
@@ -62,16 +42,39 @@ public:
     int run(); //Main loop.
 
 private:
+    //Frame graph resources: what each stage of run() reads and writes.
+    enum FrameResource
+    {
+        FRAME_PARTICLES,    //Simulation state: physics only.
+        FRAME_SNAPSHOT,     //Front render snapshot: cull and upload read it, nobody writes it mid-frame.
+        FRAME_VISIBLE,      //frustumIndices, then visibleIndices + lastVisibleCount + lodRanges: snapshot ids.
+        FRAME_CAMERA,
+        FRAME_VIEW,         //vp and frustum planes.
+        FRAME_TARGET        //Default framebuffer: GL stages submit in the order they were added.
+    };
+
     OpenGLWindow window{ 1920, 1080, "Optimization", 3, 3, false }; //GL context + swap control.
 
     ShaderLoader instancedShader;       //Shader for instanced spheres.
     ShaderLoader wireShader;            //Shader for the wireframe box.
+    ShaderLoader impostorShader;        //Ray-cast spheres on camera-facing quads.
 
-    std::vector<Sphere> spheres;        //All simulated spheres.
+    ParticleStore particles;            //All simulated spheres (SoA streams).
+    RenderSnapshot renderSnapshot;      //What the renderer draws: last frame's published physics state.
 
     Instance instance;                  //GPU-side instancing helper.
+    std::vector<int> frustumIndices;    //Frustum cull survivors, the occlusion cull's input.
+    int frustumCount = 0;
     std::vector<int> visibleIndices;    //Compact list of visible sphere indices.
     int lastVisibleCount = 0;           //Visible count from last cull.
+    OcclusionCuller occlusion;          //Hi-Z test against the nearer spheres of the same frame.
+    bool occlusionCulling = true;       //O toggles it; the governor may still skip it (GovernorSettings).
+    LodBinner lodBinner;                //Groups visibleIndices by mesh LOD.
+    LodRanges lodRanges;                //One instanced draw each, impostors last.
+    float lodMaxRadius[MAX_LOD_BINS] = {}; //Projected radius (px) up to which each LOD holds the governor's LOD error, then IMPOSTOR_MAX_RADIUS_PX.
+    bool impostors = true;              //I toggles the impostor bin.
+    std::vector<std::uint64_t> visibleMask; //Cull kernel output, one bit per snapshot id.
+    ParallelScratch cullScratch;        //Per-chunk survivor lists of the cull compaction.
 
     Box cage{ glm::vec3(-40.f, -20.f, -45.f), glm::vec3(40.f, 20.f, 45.f) }; //World bounds.
     Camera camera{ glm::vec3(0.5f, 6.9f, 85.9f), -90.f, -6.6f };             //Free-fly camera.
@@ -82,10 +85,6 @@ private:
     double fps = 0.0;             //Averaged FPS (1s window).
 
 #if PHYSICS
-    glm::vec3 gravity{ 0.0f, -9.81f, 0.0f }; //Constant gravity.
-    float restitutionSphere = 0.9f;          //Bounciness for sphere-sphere collisions.
-    float restitutionWall = 0.8f;            //Bounciness for wall-sphere collisions.
-    const float physicsDt = 1.0f / 240.0f;   //Fixed step time.
     double physicsAccumulator = 0.0;         //Accumulator for fixed stepping.
 #endif
 
@@ -95,5 +94,7 @@ private:
 
     static int cachedW, cachedH;  //Cached viewport to avoid redundant glViewport.
 
-    UniformGrid grid;             //Broadphase (bucket grid) for potential pairs.
+    PhysicsPipeline physics;      //Fixed substep shared with the headless benchmark. L/B cycle its modes.
+    TaskGraph frameGraph;         //Rebuilt each frame, keeps its capacity.
+    FrameGovernor governor{ TARGET_FRAME_MS, 1000.0 / PHYSICS_HZ }; //Picks solver iterations, substeps and cull detail per frame.
 };
\ No newline at end of file
@@ -1,9 +1,16 @@
 #pragma once
 
 #define PHYSICS 1
+#define FORCE_SCALAR_KERNELS 0 //1 = run SIMD-dispatched kernels on their scalar reference path (for checking results).
+#define DETERMINISTIC_PHYSICS 0 //1 = bit-identical trajectories for any worker count (canonical pair order, no spinlock solver).
+#define PROFILING 1 //0 = scoped timers compile away (no event rings, HUD breakdown or trace dump).
 
 //--TUNABLES--
-static constexpr int SPHERE_XSEGS = 24;
-static constexpr int SPHERE_YSEGS = 24;
+static constexpr int SPHERE_SUBDIVISIONS = 3; //Finest icosphere LOD (1280 triangles), each coarser LOD has one subdivision less down to 0.
+static constexpr float LOD_ERROR_PX = 0.5f;   //Largest silhouette error, in pixels, a coarser LOD may show.
+static constexpr float IMPOSTOR_MAX_RADIUS_PX = 8.0f; //Spheres projecting this small are ray-cast on a 2-triangle quad instead. I toggles.
 static constexpr int INSTANCE_COUNT = 50000;
+static constexpr float RADIUS_SPREAD = 1.0f; //Largest / smallest radius. > 1 spawns mixed sizes on the hierarchical grid.
+static constexpr float PHYSICS_HZ = 120.0f;  //Fixed step rate. Rendering interpolates between the last two steps, so it can sit below the frame rate.
+static constexpr double TARGET_FRAME_MS = 1000.0 / 60.0; //CPU frame budget the governor holds (display refresh). G toggles it.
 //--TUNABLES-END--
\ No newline at end of file
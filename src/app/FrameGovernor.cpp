@@ -0,0 +1,113 @@
+/*
+    Frame governor implementation: smoothed cost model, knob selection with hysteresis.
+*/
+
+#include "FrameGovernor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    const double SMOOTHING = 0.1;       //Weight of the newest frame in the averages.
+    const double SAFETY = 0.9;          //Share of the target the model plans for (timer noise, driver, present).
+    const double RAISE_MARGIN = 0.8;    //Quality goes up only if the richer setting stays under this share.
+    const int HOLD_FRAMES = 30;
+
+    inline void smooth(double& average, double sample) { average += SMOOTHING * (sample - average); }
+}
+
+FrameGovernor::FrameGovernor(double targetMs, double stepMs)
+    : targetMs(targetMs), stepMs(stepMs)
+{
+}
+
+void FrameGovernor::observe(const FrameCosts& costs)
+{
+    //--SMOOTHED-COSTS--
+    double stepSample = 0.0, iterationSample = 0.0;
+    const bool stepped = costs.substeps > 0 && costs.solverIterations > 0;
+
+    if (stepped)
+    {
+        iterationSample = costs.solveMs / costs.substeps / costs.solverIterations;
+        stepSample = std::max(0.0, costs.physicsMs / costs.substeps - iterationSample * costs.solverIterations);
+    }
+
+    if (!primed) //First sample seeds the averages.
+    {
+        intervalMs = costs.intervalMs;
+        graphMs = costs.graphMs;
+        renderMs = costs.renderMs;
+        primed = true;
+    }
+    else
+    {
+        smooth(intervalMs, costs.intervalMs);
+        smooth(graphMs, costs.graphMs);
+        smooth(renderMs, costs.renderMs);
+    }
+
+    if (costs.occlusionMs > 0.0) smooth(occlusionMs, costs.occlusionMs);
+
+    if (stepped && !physicsPrimed)
+    {
+        baseStepMs = stepSample;
+        iterationMs = iterationSample;
+        physicsPrimed = true;
+    }
+    else if (stepped)
+    {
+        smooth(baseStepMs, stepSample);
+        smooth(iterationMs, iterationSample);
+    }
+    //--SMOOTHED-COSTS-END--
+
+    if (holdFrames > 0) --holdFrames;
+
+    const double usable = targetMs * SAFETY;
+    const double substepsNeeded = std::max(1.0, intervalMs / stepMs);
+    const GovernorSettings previous = settings;
+
+    //--PHYSICS-KNOBS-- (most iterations that fit every needed substep; lowering is immediate, raising waits)
+    int iterations = MIN_ITERATIONS;
+    for (int k = MAX_ITERATIONS; k > MIN_ITERATIONS; --k)
+    {
+        const bool raise = k > settings.solverIterations;
+        if (raise && holdFrames > 0) continue;
+
+        if (physicsCost(k, substepsNeeded) <= usable * (raise ? RAISE_MARGIN : 1.0))
+        {
+            iterations = k;
+            break;
+        }
+    }
+    settings.solverIterations = iterations;
+
+    const double stepCost = physicsCost(iterations, 1.0);
+    const int affordable = stepCost > 0.0 ? static_cast<int>(std::floor(usable / stepCost)) : MAX_SUBSTEPS;
+    settings.maxSubsteps = std::clamp(affordable, 1, MAX_SUBSTEPS);
+    //--PHYSICS-KNOBS-END--
+
+    //--RENDER-KNOBS-- (feedback: physics overlaps render, so only the measured graph tells whether it fits)
+    const bool renderBound = renderMs >= physicsCost(iterations, std::min(substepsNeeded, double(settings.maxSubsteps)));
+
+    if (graphMs > usable && renderBound && holdFrames <= HOLD_FRAMES / 2) //Half a hold: the average must see the last step first.
+    {
+        if (settings.occlusionCulling) settings.occlusionCulling = false;                                                         //Free for the image first,
+        else if (settings.lodErrorPx < MAX_LOD_ERROR_PX) settings.lodErrorPx = std::min(MAX_LOD_ERROR_PX, settings.lodErrorPx + PIXEL_STEP); //then cheaper meshes,
+        else settings.minPixelRadius = std::min(MAX_PIXEL_RADIUS, settings.minPixelRadius + PIXEL_STEP);                              //then fewer spheres.
+    }
+    else if (graphMs < usable * RAISE_MARGIN && holdFrames == 0)
+    {
+        if (settings.minPixelRadius > 0.0f) settings.minPixelRadius = std::max(0.0f, settings.minPixelRadius - PIXEL_STEP);
+        else if (settings.lodErrorPx > LOD_ERROR_PX) settings.lodErrorPx = std::max(LOD_ERROR_PX, settings.lodErrorPx - PIXEL_STEP);
+        else if (!settings.occlusionCulling && graphMs + occlusionMs < usable * RAISE_MARGIN) settings.occlusionCulling = true; //Only if it fits again.
+    }
+    //--RENDER-KNOBS-END--
+
+    const bool changed = settings.solverIterations != previous.solverIterations || settings.maxSubsteps != previous.maxSubsteps
+                      || settings.minPixelRadius != previous.minPixelRadius || settings.lodErrorPx != previous.lodErrorPx
+                      || settings.occlusionCulling != previous.occlusionCulling;
+    if (changed) holdFrames = HOLD_FRAMES; //Let the averages see the new setting before the next raise.
+}
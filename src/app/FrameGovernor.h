@@ -0,0 +1,77 @@
+/*
+    Frame governor header: holds a CPU frame budget by trading solver iterations, substeps and cull detail.
+*/
+
+#pragma once
+
+#include "AppConfig.h"
+
+//What one frame cost, measured by App and fed back once the frame graph has finished.
+struct FrameCosts
+{
+    double intervalMs = 0.0;        //Wall time since the previous frame: what the physics accumulator gained.
+    double graphMs = 0.0;           //CPU time of the frame graph (everything but present).
+    double physicsMs = 0.0;         //Sum over this frame's substeps.
+    double solveMs = 0.0;           //Part of physicsMs that scales with solverIterations (contact solve passes).
+    int substeps = 0;
+    int solverIterations = 0;       //In effect for those substeps.
+    double renderMs = 0.0;          //Cull + upload + draw.
+    double occlusionMs = 0.0;       //Part of renderMs spent in the occlusion cull, 0 when it did not run.
+};
+
+//Knobs for the next frame.
+struct GovernorSettings
+{
+    int solverIterations = 4;       //Contact passes per substep.
+    int maxSubsteps = 4;            //Above this the simulation slows down instead of the frame rate.
+    float minPixelRadius = 0.0f;    //Spheres that project smaller are culled, 0 = off.
+    float lodErrorPx = LOD_ERROR_PX; //Silhouette error, in pixels, a coarser mesh LOD may show.
+    bool occlusionCulling = true;   //Hi-Z pass over the frustum survivors: CPU time that only drops covered spheres.
+};
+
+//Physics knobs come from a cost model, render knobs from feedback. Per substep, physics costs
+//base + iterations * perIteration, both smoothed from the pipeline's own timings: perIteration from the solve
+//passes alone, base from everything else (contact build included). The substeps a frame needs
+//follow from the frame interval. The governor keeps the most solver iterations whose cost fits the budget.
+//If even one iteration does not fit, it caps the substep count: time is then lost predictably instead of
+//the frame rate collapsing.
+//The render side coarsens while the frame is over budget and render is the larger half: first it skips the
+//occlusion cull (it costs CPU and hides nothing that would be seen), then raises the LOD error (coarser meshes at
+//the same distance) up to MAX_LOD_ERROR_PX, then the minimum projected radius (fewer spheres), both in half-pixel
+//steps. With headroom it walks back in reverse order; the occlusion cull only returns once its last measured
+//cost also fits. Raising quality waits HOLD_FRAMES
+//after any change and needs RAISE_MARGIN of the budget free, so settings do not flap at the edge.
+class FrameGovernor
+{
+public:
+    static constexpr int MIN_ITERATIONS = 1;
+    static constexpr int MAX_ITERATIONS = 4;
+    static constexpr int MAX_SUBSTEPS = 4;
+    static constexpr float PIXEL_STEP = 0.5f;
+    static constexpr float MAX_PIXEL_RADIUS = 3.0f;
+    static constexpr float MAX_LOD_ERROR_PX = 2.0f;
+
+    FrameGovernor(double targetMs, double stepMs); //Frame budget and physics dt, both in milliseconds.
+
+    void observe(const FrameCosts& costs);
+
+    const GovernorSettings& getSettings() const { return enabled ? settings : DEFAULTS; }
+    double getTargetMs() const { return targetMs; }
+    double getHeadroomMs() const { return targetMs - graphMs; } //Budget left over by the smoothed frame graph.
+
+    bool enabled = true; //Off = full quality, measurements keep running.
+
+private:
+    static inline const GovernorSettings DEFAULTS{};
+
+    double physicsCost(int iterations, double substeps) const { return substeps * (baseStepMs + iterations * iterationMs); }
+
+    double targetMs, stepMs;
+    GovernorSettings settings;
+
+    bool primed = false, physicsPrimed = false;
+    double intervalMs = 0.0, graphMs = 0.0, renderMs = 0.0;
+    double occlusionMs = 0.0;       //Smoothed over the frames it ran, kept while it is skipped.
+    double baseStepMs = 0.0, iterationMs = 0.0;
+    int holdFrames = 0;             //Frames until quality may go up again.
+};
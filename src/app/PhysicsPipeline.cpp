@@ -0,0 +1,322 @@
+/*
+    Physics pipeline implementation: stratified spawn and the fixed substep with per-stage timings.
+*/
+
+#include "PhysicsPipeline.h"
+
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+//--SPAWN-RNG--
+namespace
+{
+    struct spawnRNG
+    {
+        uint32_t s;
+        explicit spawnRNG(uint32_t seed) : s(seed ? seed : 1u) {}
+        inline uint32_t u32() { s ^= s << 13; s ^= s >> 17; s ^= s << 5; return s; }
+        inline float f01() { return (float)((u32() >> 8) * (1.0 / 16777215.0)); }
+        inline glm::vec3 f3() { return glm::vec3(f01(), f01(), f01()); }
+    };
+}
+//--SPAWN-RNG-END--
+
+//--STAGE-CLOCK--
+namespace
+{
+    using StageClock = std::chrono::steady_clock;
+
+    inline double elapsedMs(StageClock::time_point& mark)
+    {
+        const StageClock::time_point now = StageClock::now();
+        const double ms = std::chrono::duration<double, std::milli>(now - mark).count();
+        mark = now; //Next stage starts where this one ended.
+        return ms;
+    }
+}
+//--STAGE-CLOCK-END--
+
+void spawnStratified(ParticleStore& particles, int count, const glm::vec3& regionMin, const glm::vec3& regionMax,
+                     float radius, float radiusSpread, std::uint32_t seed)
+{
+    //--STRATIFIED-SPAWN--
+    particles.reserve(particles.size() + count); //Reserve upfront to avoid reallocation churn.
+
+    const int side = static_cast<int>(std::ceil(std::cbrt(static_cast<double>(count))));
+    const glm::vec3 regionSize = regionMax - regionMin;
+    const glm::vec3 cell = regionSize / static_cast<float>(side);
+    const bool mixed = radiusSpread > 1.0f;
+
+    spawnRNG frng(seed);
+    int placed = 0;
+
+    for (int z = 0; z < side && placed < count; ++z)
+    {
+        for (int y = 0; y < side && placed < count; ++y)
+        {
+            for (int x = 0; x < side && placed < count; ++x)
+            {
+                const float r = mixed ? radius * std::pow(radiusSpread, frng.f01()) : radius; //Log-uniform sizes.
+
+                glm::vec3 base = regionMin + (glm::vec3(x, y, z) + glm::vec3(0.5f)) * cell; //Center of grid cell.
+                glm::vec3 jitter = (frng.f3() - glm::vec3(0.5f)) * glm::max(cell - glm::vec3(r * 2.0f), glm::vec3(0.0f)); //Small random offset inside cell.
+                glm::vec3 pos = glm::clamp(base + jitter, regionMin + glm::vec3(r), regionMax - glm::vec3(r)); //Clamp to avoid spawning intersecting the walls.
+
+                particles.add(pos, r);
+                ++placed;
+            }
+        }
+    }
+    //--STRATIFIED-SPAWN-END--
+}
+
+void PhysicsPipeline::configure(const glm::vec3& boxMin, const glm::vec3& boxMax, float radius, float maxRadius, bool deterministic)
+{
+    this->boxMin = boxMin;
+    this->boxMax = boxMax;
+    polydisperse = maxRadius > radius;
+
+    grid.resize(boxMin, boxMax, radius * 2.0f);         //Cell size is around the same as diameter for good neighborhood locality.
+    grid.setDeterministic(deterministic);               //Canonical pair order, results independent of the worker count.
+    restingGrid.resize(boxMin, boxMax, radius * 2.0f);  //Same cells, so the two layers line up.
+    restingGrid.setDeterministic(deterministic);
+    restingDirty = true;
+    hgrid.resize(boxMin, boxMax, radius, maxRadius);    //Same box, one level per octave of radius.
+    hgrid.setDeterministic(deterministic);
+    sap.margin = ContactSolverSettings().margin;        //Keep speculative contacts the grids find through their cell slack.
+    bvh.margin = sap.margin;
+}
+
+void PhysicsPipeline::prime(ThreadSystem& tasks, const ParticleStore& particles)
+{
+    //--LOCKS-INIT--
+    if (lockCount != particles.size())
+    {
+        sphereLocks.reset(new SphereLock[particles.size()]); //Allocate per-sphere locks once per spawn.
+        lockCount = particles.size();
+    }
+    //--LOCKS-INIT-END--
+
+    //--GRID-WARMUP--
+    if (polydisperse) hgrid.build(tasks, particles); //Prime broadphase grid for first frame.
+    else grid.build(tasks, particles);
+    //--GRID-WARMUP-END--
+}
+
+void PhysicsPipeline::remapIds(const std::vector<int>& oldToNew)
+{
+    //Every id-keyed structure that outlives a substep follows the permutation.
+    //sphereLocks are all released between passes and carry no per-sphere state, so they need no remap.
+    contacts.remapIds(oldToNew);
+    sap.remapIds(oldToNew);
+    bvh.remapIds(oldToNew);
+}
+
+void PhysicsPipeline::step(ThreadSystem& tasks, ParticleStore& particles)
+{
+    const int N = particles.size();
+
+    timings = PhysicsTimings{};
+    reordered = false;
+    skipped = false;
+
+    //--SLEEPING-- (a fully settled scene costs nothing until something wakes it)
+    sleep.enabled = (solverMode == SolverMode::ContactList); //Islands need the contact list; other solver modes keep everything awake.
+    if (!sleep.enabled && sleep.getAwakeCount() != N) sleep.wakeAll(tasks, particles);
+    skipped = sleep.allAsleep();
+    if (skipped) return; //The contact list still holds the last awake pairs, getContactCount() reports none.
+    //--SLEEPING-END--
+
+    if (lockCount != N) prime(tasks, particles); //Spawned without prime().
+
+    const StageClock::time_point start = StageClock::now();
+    StageClock::time_point mark = start;
+
+    //--SPATIAL-REORDER-- (every K substeps, or early when grid locality degrades)
+    {
+        PROFILE_SCOPE("reorder");
+
+        reorder.tick();
+        if (reorder.due())
+        {
+            reorder.reorder(tasks, particles, grid.getBoxMin(), grid.getCellSize());
+            remapIds(reorder.getOldToNew());
+            sleep.refreshIds(tasks, particles); //The awake flags moved with the spheres.
+            restingDirty = true;
+            reordered = true;
+        }
+    }
+    timings.reorder = elapsedMs(mark);
+    //--SPATIAL-REORDER-END--
+
+    //--INTEGRATE+WALL-COLLISIONS+BINNING-- (one parallel SIMD sweep; the uniform grid bins each block while it is in cache)
+    //Walls are clamped inside the integrate kernel, a few compares on lanes it already holds. Any near-wall subset
+    //would cost more to track than the clamp it saves.
+    const bool fusedGrid = (broadphaseMode == BroadphaseMode::Grid && !polydisperse);
+    const std::vector<int>* awakeIds = sleep.getAwakeIds(N);   //nullptr while nothing sleeps: every sphere, in place.
+    const int active = awakeIds ? (int)awakeIds->size() : N;
+    const bool layered = fusedGrid && awakeIds;                 //grid holds the awake spheres, restingGrid the rest.
+
+    {
+        PROFILE_SCOPE("integrate");
+
+        IntegrateParams stepParams;
+        stepParams.gravity = gravity;
+        stepParams.dt = dt;
+        stepParams.boxMin = boxMin;
+        stepParams.boxMax = boxMax;
+        stepParams.restitution = restitutionWall;
+
+        if (fusedGrid) grid.beginBuild(tasks, active, awakeIds);
+
+        auto integrateSlots = [&](int i0, int i1)
+        {
+            if (!awakeIds)
+            {
+                integrateWalls(particles, i0, i1, stepParams, simdLevel); //Euler + AABB bounce in one sweep.
+                return;
+            }
+
+            const int* ids = awakeIds->data();
+            for (int run = i0; run < i1;)                                   //Runs of consecutive awake ids keep the SIMD sweep.
+            {
+                int next = run + 1;
+                while (next < i1 && ids[next] == ids[next - 1] + 1) ++next;
+                integrateWalls(particles, ids[run], ids[next - 1] + 1, stepParams, simdLevel);
+                run = next;
+            }
+        };
+
+        //parallelFor hands each worker one large range; blocks of it are binned while their fresh positions are
+        //still in L2 (p, v and r of a block are ~56 KB), otherwise the fused pass reloads as much as two passes.
+        const int FUSE_BLOCK = 2048;
+
+        tasks.parallelFor(0, active, FUSE_BLOCK, [&](int i0, int i1, int k)
+        {
+            for (int b0 = i0; b0 < i1; b0 += FUSE_BLOCK)
+            {
+                const int b1 = std::min(b0 + FUSE_BLOCK, i1);
+                integrateSlots(b0, b1);
+                if (fusedGrid) grid.binRange(particles, b0, b1, k);    //Cell key + histogram from the fresh positions.
+            }
+        });
+    }
+    timings.integrate = elapsedMs(mark);
+    //--INTEGRATE+WALL-COLLISIONS+BINNING-END--
+
+    //--GRID-REBUILD-- (parallel counting sort into CSR buckets, the incremental sweep, or the tree)
+    {
+        PROFILE_SCOPE("broadphase");
+
+        if (broadphaseMode == BroadphaseMode::SweepAndPrune)
+        {
+            sap.build(tasks, particles);                                        //Bounds refresh + insertion sort, mostly no-op moves.
+        }
+        else if (broadphaseMode == BroadphaseMode::LinearBvh)
+        {
+            bvh.build(tasks, particles);                                        //Refit, or Morton sort + parallel topology when stale.
+        }
+        else if (polydisperse)
+        {
+            hgrid.build(tasks, particles);                                      //Per-octave levels + cross-level bins.
+            if (reorder.sampleDue()) reorder.observe(hgrid.getLevel(0).measureIdSpread(tasks));
+        }
+        else
+        {
+            grid.finishBuild(tasks);                                            //Prefix sum + scatter of the buckets binned above.
+            if (layered && restingDirty)
+            {
+                restingGrid.build(tasks, particles, &sleep.getSleeperIds());    //Sleepers do not move, so only when the set changes.
+                restingDirty = false;
+            }
+            if (reorder.sampleDue()) reorder.observe(grid.measureIdSpread(tasks)); //Locality metric for early reorders.
+        }
+    }
+    timings.broadphase = elapsedMs(mark);
+    //--GRID-REBUILD-END--
+
+    //--SPHERE-SPHERE-COLLISIONS-- (contact list, colored cells lock-free, or ordered spinlocks in narrowphase)
+    {
+        PROFILE_SCOPE("narrowphase");
+
+        if (solverMode == SolverMode::ContactList)
+        {
+            ContactSolverSettings solverSettings;
+            solverSettings.iterations = solverIterations;
+            solverSettings.dt = dt;
+            solverSettings.restitution = restitutionSphere;
+
+            if (broadphaseMode == BroadphaseMode::SweepAndPrune) contacts.build(tasks, sap, particles, solverSettings); //Broadphase once per substep.
+            else if (broadphaseMode == BroadphaseMode::LinearBvh) contacts.build(tasks, bvh, particles, solverSettings);
+            else if (polydisperse) contacts.build(tasks, hgrid, particles, solverSettings);
+            else if (layered) contacts.build(tasks, LayeredGridPairs{ grid, restingGrid }, particles, solverSettings); //Awake pairs + awake against sleepers.
+            else contacts.build(tasks, grid, particles, solverSettings);
+            timings.contactBuild = elapsedMs(mark);
+
+            contacts.solve(tasks, particles, solverSettings);                   //N cheap passes over the compact list.
+            timings.contactSolve = elapsedMs(mark);
+        }
+        else
+        {
+            auto getPos = [&](int id) -> glm::vec3 { return particles.getPosition(id); };
+            auto getRad = [&](int id) -> float { return particles.radius[id]; };
+
+            auto resolveDirect = [&](const auto& broadphase) //Same resolve on any broadphase.
+            {
+                for (int iter = 0; iter < solverIterations; ++iter)             //Each pass enumerates pairs again, nothing to build up front.
+                {
+                    if (solverMode == SolverMode::CellColored)
+                    {
+                        broadphase.forEachPotentialPairColoredParallel
+                        (
+                            tasks, getPos, getRad,
+                            [&](int a, int b)
+                            {
+                                particles.collide(a, b, restitutionSphere); //Same-color cells never share spheres, no locks needed.
+                            }
+                        );
+                    }
+                    else
+                    {
+                        broadphase.forEachPotentialPairPrunedParallel
+                        (
+                            tasks, getPos, getRad,
+                            [&](int a, int b)
+                            {
+                                int i = a, j = b;
+                                if (i > j) std::swap(i, j); //Order locks to avoid deadlock.
+
+                                sphereLocks[i].lock();
+                                sphereLocks[j].lock();
+                                particles.collide(a, b, restitutionSphere); //Narrow-phase resolve.
+                                sphereLocks[j].unlock();
+                                sphereLocks[i].unlock();
+                            }
+                        );
+                    }
+                }
+            };
+
+            if (broadphaseMode == BroadphaseMode::SweepAndPrune) resolveDirect(sap);
+            else if (broadphaseMode == BroadphaseMode::LinearBvh) resolveDirect(bvh);
+            else if (polydisperse) resolveDirect(hgrid);
+            else resolveDirect(grid);
+            timings.contactSolve = elapsedMs(mark);
+        }
+    }
+    timings.narrowphase = timings.contactBuild + timings.contactSolve;
+    //--SPHERE-SPHERE-COLLISIONS-END--
+
+    //--ISLAND-SLEEP-WAKE-- (needs the contact list; other solver modes keep everything awake)
+    {
+        PROFILE_SCOPE("sleep");
+
+        sleep.update(tasks, particles, contacts, dt);
+        if (sleep.sleepersChanged()) restingDirty = true;
+    }
+    timings.sleep = elapsedMs(mark);
+    //--ISLAND-SLEEP-WAKE-END--
+
+    timings.total = std::chrono::duration<double, std::milli>(mark - start).count();
+}
@@ -0,0 +1,123 @@
+/*
+    Physics pipeline header: the fixed substep (reorder, integrate, broadphase, contacts, sleep) without any GL.
+*/
+
+#pragma once
+
+#include "AppConfig.h"
+#include "../scene/ParticleStore.h"
+#include "../optimization/UniformGrid.h"
+#include "../optimization/HierarchicalGrid.h"
+#include "../optimization/SweepAndPrune.h"
+#include "../optimization/LinearBvh.h"
+#include "../optimization/ThreadSystem.h"
+#include "../optimization/SimdIntegrator.h"
+#include "../optimization/ContactSolver.h"
+#include "../optimization/SpatialReorder.h"
+#include "../optimization/SleepIslands.h"
+
+#include <glm.hpp>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+//--SPHERE-LOCKS--
+struct SphereLock
+{
+    std::atomic_flag f = ATOMIC_FLAG_INIT;
+    SphereLock() noexcept = default;
+    SphereLock(const SphereLock&) = delete;
+    SphereLock& operator=(const SphereLock&) = delete;
+
+    inline void lock() { while (f.test_and_set(std::memory_order_acquire)) {} }
+    inline void unlock() { f.clear(std::memory_order_release); }
+};
+//--SPHERE-LOCKS-END--
+
+//--SOLVER-MODES--
+enum class SolverMode
+{
+    ContactList,    //Broadphase once per substep, warm-started impulse iterations over colored batches.
+    CellColored,    //Direct resolve per enumerated pair, lock-free via cell color classes.
+    SpinLocks       //Direct resolve per enumerated pair, ordered per-sphere spinlocks.
+};
+
+enum class BroadphaseMode
+{
+    Grid,           //UniformGrid, or HierarchicalGrid when radii are mixed. Rebuilt every substep.
+    SweepAndPrune,  //Persistent sorted intervals, insertion-sorted every substep.
+    LinearBvh       //Morton-sorted tree, refit while spheres move little. No dense cell table, suits sparse scenes.
+};
+//--SOLVER-MODES-END--
+
+//Wall time of the stages of the last substep, in milliseconds (all zero when the scene slept through it).
+struct PhysicsTimings
+{
+    double reorder = 0.0;       //Spatial reorder + id remaps (usually 0, it runs every few hundred substeps).
+    double integrate = 0.0;     //Euler + walls, plus uniform-grid binning when fused.
+    double broadphase = 0.0;    //Rest of the broadphase build.
+    double narrowphase = 0.0;   //Contact build + solve, or the direct resolve passes.
+    double contactBuild = 0.0;  //Part of narrowphase paid once per substep (contact list emission, 0 for direct resolve).
+    double contactSolve = 0.0;  //Part of narrowphase that scales with solverIterations.
+    double sleep = 0.0;         //Island update.
+    double total = 0.0;
+};
+
+//Stratified spawn: one sphere per cell of a ceil(cbrt(count))^3 lattice over the region, jittered inside its
+//cell and clamped off the region walls. Radii are log-uniform in [radius, radius * radiusSpread]. Same seed,
+//same scene.
+void spawnStratified(ParticleStore& particles, int count, const glm::vec3& regionMin, const glm::vec3& regionMax,
+                     float radius, float radiusSpread, std::uint32_t seed);
+
+//Everything one fixed physics substep needs, owned in one place so the windowed App and the headless
+//benchmark run the same code. The ParticleStore stays with the caller (App renders from it).
+class PhysicsPipeline
+{
+public:
+    glm::vec3 gravity{ 0.0f, -9.81f, 0.0f }; //Constant gravity.
+    float restitutionSphere = 0.9f;          //Bounciness for sphere-sphere collisions.
+    float restitutionWall = 0.8f;            //Bounciness for wall-sphere collisions.
+    float dt = 1.0f / 240.0f;                //Fixed step time.
+    int solverIterations = 4;                //Solver passes per substep: contact list iterations, or direct resolve passes.
+    SolverMode solverMode = SolverMode::ContactList;        //Narrow-phase strategy.
+    BroadphaseMode broadphaseMode = BroadphaseMode::Grid;   //Pair source.
+    SimdLevel simdLevel = FORCE_SCALAR_KERNELS ? SimdLevel::Scalar : detectSimdLevel(); //ISA picked once at startup.
+
+    //Cage and radius range; maxRadius > radius switches the grid path to the hierarchical grid.
+    void configure(const glm::vec3& boxMin, const glm::vec3& boxMax, float radius, float maxRadius, bool deterministic);
+    void prime(ThreadSystem& tasks, const ParticleStore& particles);   //Per-sphere locks + first broadphase after a spawn.
+    void step(ThreadSystem& tasks, ParticleStore& particles);          //One substep of length dt.
+
+    //oldToNew of the storage permutation done by the last step, nullptr if it did not reorder.
+    const std::vector<int>* getLastPermutation() const { return reordered ? &reorder.getOldToNew() : nullptr; }
+
+    const PhysicsTimings& getTimings() const { return timings; }
+    int getContactCount() const { return skipped ? 0 : contacts.getContactCount(); } //Of the last step (0 if it slept through).
+    bool allAsleep() const { return sleep.allAsleep(); }
+    int getAwakeCount() const { return sleep.getAwakeCount(); }
+    bool isPolydisperse() const { return polydisperse; }
+
+private:
+    void remapIds(const std::vector<int>& oldToNew); //Follow a particle permutation in id-keyed state.
+
+    glm::vec3 boxMin{ 0.0f }, boxMax{ 0.0f };
+    bool polydisperse = false;    //Pick hgrid over grid.
+
+    UniformGrid grid;             //Broadphase (bucket grid) for potential pairs. Only the awake spheres while some sleep.
+    UniformGrid restingGrid;      //The sleeping spheres, rebuilt only when they change (paired through LayeredGridPairs).
+    bool restingDirty = true;     //Sleepers changed or were renumbered since restingGrid was built.
+    HierarchicalGrid hgrid;       //Multi-level broadphase for mixed radii (one level per radius octave).
+    SweepAndPrune sap;            //Alternative broadphase, coherent across substeps.
+    LinearBvh bvh;                //Alternative broadphase, memory follows the sphere count instead of the volume.
+    ContactSolver contacts;       //Persistent contact list + warm start cache.
+    SpatialReorder reorder;       //Periodic Morton-order permutation of particle storage.
+    SleepIslands sleep;           //Resting islands skip integration and solving until woken.
+
+    std::unique_ptr<SphereLock[]> sphereLocks; //One spinlock per sphere for ordered narrow-phase locking.
+    int lockCount = 0;
+
+    PhysicsTimings timings;
+    bool reordered = false;
+    bool skipped = false;         //The last step did nothing: everything was asleep.
+};
@@ -0,0 +1,386 @@
+/*
+    Headless physics benchmark: runs the app's fixed substep on named, seeded scenes and reports per-stage timings.
+*/
+
+#include "../app/PhysicsPipeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+//--SCENARIOS--
+namespace
+{
+    const glm::vec3 CAGE_MIN(-40.f, -20.f, -45.f); //Same cage as the windowed app.
+    const glm::vec3 CAGE_MAX(40.f, 20.f, 45.f);
+    const float SPHERE_RADIUS = 0.25f;
+
+    struct Scenario
+    {
+        const char* name;
+        const char* description;
+        int count;                  //Sphere count.
+        glm::vec3 spawnMin, spawnMax; //Stratified spawn region (inside the cage).
+        float warmupSeconds;        //Untimed simulated time before measuring, unless --warmup overrides it.
+        int maxAwakeAtEnd;          //--check fails the run above this many awake spheres (-1 = no expectation).
+    };
+
+    const Scenario SCENARIOS[] =
+    {
+        { "default50k",    "the app's startup scene: 50k spheres stratified over the whole cage",
+          50000,  CAGE_MIN, CAGE_MAX, 0.0f, -1 },
+        { "spawn500k",     "500k spheres stratified over the whole cage",
+          500000, CAGE_MIN, CAGE_MAX, 0.0f, -1 },
+        { "settledPile",   "50k spheres dropped from the lower half, timed after 12 s of settling (should be asleep: <= 1% awake)",
+          50000,  CAGE_MIN, glm::vec3(CAGE_MAX.x, 0.0f, CAGE_MAX.z), 12.0f, 500 },
+        { "clusteredDrop", "50k spheres packed into a 20^3 block at the top, falling into an empty cage",
+          50000,  glm::vec3(-10.0f, -0.5f, -10.0f), glm::vec3(10.0f, 19.5f, 10.0f), 0.0f, -1 }
+    };
+
+    const Scenario* findScenario(const std::string& name)
+    {
+        for (const Scenario& s : SCENARIOS)
+        {
+            if (name == s.name) return &s;
+        }
+        return nullptr;
+    }
+}
+//--SCENARIOS-END--
+
+//--OPTIONS--
+namespace
+{
+    struct Options
+    {
+        std::vector<std::string> scenarios;
+        int substeps = 600;         //Timed substeps (600 / hz seconds of simulated time).
+        int warmup = -1;            //Substeps, -1 = the scenario's warmupSeconds at hz.
+        float hz = PHYSICS_HZ;      //Substep rate, the app's by default.
+        int threads = 0;            //0 = ThreadSystem default (hardware - 1).
+        bool json = false;
+        bool deterministic = false;
+        bool check = false;         //Exit with 2 when a scenario misses its expectation (e.g. the pile stays awake).
+        SolverMode solverMode = SolverMode::ContactList;
+        BroadphaseMode broadphaseMode = BroadphaseMode::Grid;
+        std::string out;            //Empty = stdout.
+    };
+
+    void printUsage()
+    {
+        std::fprintf(stderr,
+            "usage: PhysicsBench [--scenario NAME|all] [--substeps N] [--warmup N] [--hz HZ] [--threads N]\n"
+            "                    [--format csv|json] [--out FILE] [--deterministic] [--check]\n"
+            "                    [--solver contacts|colored|spinlocks] [--broadphase grid|sap|bvh]\n"
+            "scenarios:\n");
+
+        for (const Scenario& s : SCENARIOS) std::fprintf(stderr, "  %-14s %s\n", s.name, s.description);
+    }
+
+    bool parseOptions(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+            const bool takesValue = arg != "--deterministic" && arg != "--check" && arg != "--help";
+
+            if (takesValue && !value)
+            {
+                std::fprintf(stderr, "missing value for %s\n", arg.c_str());
+                return false;
+            }
+
+            if (arg == "--scenario")
+            {
+                if (std::strcmp(value, "all") == 0)
+                {
+                    for (const Scenario& s : SCENARIOS) options.scenarios.push_back(s.name);
+                }
+                else if (findScenario(value))
+                {
+                    options.scenarios.push_back(value);
+                }
+                else
+                {
+                    std::fprintf(stderr, "unknown scenario %s\n", value);
+                    return false;
+                }
+            }
+            else if (arg == "--substeps") options.substeps = std::max(1, std::atoi(value));
+            else if (arg == "--warmup") options.warmup = std::max(0, std::atoi(value));
+            else if (arg == "--hz") options.hz = std::max(1.0f, (float)std::atof(value));
+            else if (arg == "--threads") options.threads = std::max(0, std::atoi(value));
+            else if (arg == "--out") options.out = value;
+            else if (arg == "--format")
+            {
+                if (std::strcmp(value, "json") == 0) options.json = true;
+                else if (std::strcmp(value, "csv") == 0) options.json = false;
+                else return false;
+            }
+            else if (arg == "--solver")
+            {
+                if (std::strcmp(value, "contacts") == 0) options.solverMode = SolverMode::ContactList;
+                else if (std::strcmp(value, "colored") == 0) options.solverMode = SolverMode::CellColored;
+                else if (std::strcmp(value, "spinlocks") == 0) options.solverMode = SolverMode::SpinLocks;
+                else return false;
+            }
+            else if (arg == "--broadphase")
+            {
+                if (std::strcmp(value, "grid") == 0) options.broadphaseMode = BroadphaseMode::Grid;
+                else if (std::strcmp(value, "sap") == 0) options.broadphaseMode = BroadphaseMode::SweepAndPrune;
+                else if (std::strcmp(value, "bvh") == 0) options.broadphaseMode = BroadphaseMode::LinearBvh;
+                else return false;
+            }
+            else if (arg == "--deterministic")
+            {
+                options.deterministic = true;
+                continue;
+            }
+            else if (arg == "--check")
+            {
+                options.check = true;
+                continue;
+            }
+            else
+            {
+                return false;
+            }
+
+            ++i; //Consumed the value.
+        }
+
+        if (options.deterministic && options.solverMode == SolverMode::SpinLocks)
+        {
+            std::fprintf(stderr, "spinlock resolve order follows lock races, it cannot be deterministic\n");
+            return false;
+        }
+
+        if (options.scenarios.empty()) options.scenarios.push_back(SCENARIOS[0].name);
+        return true;
+    }
+}
+//--OPTIONS-END--
+
+//--STATS--
+namespace
+{
+    struct StageStats
+    {
+        double mean = 0.0, p50 = 0.0, p95 = 0.0, max = 0.0;
+    };
+
+    StageStats summarize(std::vector<double> samples)
+    {
+        StageStats stats;
+        if (samples.empty()) return stats;
+
+        std::sort(samples.begin(), samples.end());
+
+        double sum = 0.0;
+        for (double s : samples) sum += s;
+
+        const size_t last = samples.size() - 1;
+        stats.mean = sum / samples.size();
+        stats.p50 = samples[last / 2];
+        stats.p95 = samples[(last * 95) / 100];
+        stats.max = samples[last];
+        return stats;
+    }
+
+    //FNV-1a over the position and velocity bits: equal digests mean bit-identical end states.
+    std::uint64_t stateDigest(const ParticleStore& particles)
+    {
+        std::uint64_t h = 1469598103934665603ull;
+
+        auto mix = [&](const AlignedFloats& stream)
+        {
+            for (float f : stream)
+            {
+                std::uint32_t bits;
+                std::memcpy(&bits, &f, sizeof(bits));
+                h = (h ^ bits) * 1099511628211ull;
+            }
+        };
+
+        mix(particles.px); mix(particles.py); mix(particles.pz);
+        mix(particles.vx); mix(particles.vy); mix(particles.vz);
+        return h;
+    }
+
+    struct Result
+    {
+        const Scenario* scenario = nullptr;
+        int threads = 0;
+        int substeps = 0;
+        int warmup = 0;
+        float hz = 0.0f;
+        double setupMs = 0.0;       //Spawn + prime + warmup.
+        StageStats stages[6];       //Same order as STAGE_NAMES.
+        double meanContacts = 0.0;
+        int awakeAtEnd = 0;
+        std::uint64_t digest = 0;
+    };
+
+    const char* STAGE_NAMES[6] = { "reorder", "integrate", "broadphase", "narrowphase", "sleep", "total" };
+}
+//--STATS-END--
+
+//--RUN--
+namespace
+{
+    Result runScenario(const Scenario& scenario, const Options& options, ThreadSystem& threads)
+    {
+        const auto setupStart = std::chrono::steady_clock::now();
+
+        PhysicsPipeline physics;
+        physics.solverMode = options.solverMode;
+        physics.broadphaseMode = options.broadphaseMode;
+        physics.dt = 1.0f / options.hz; //Same step as the app unless --hz says otherwise.
+        physics.configure(CAGE_MIN, CAGE_MAX, SPHERE_RADIUS, SPHERE_RADIUS, options.deterministic);
+
+        ParticleStore particles;
+        spawnStratified(particles, scenario.count, scenario.spawnMin, scenario.spawnMax, SPHERE_RADIUS, 1.0f, 0xC001CAFEu);
+        physics.prime(threads, particles);
+
+        Result result;
+        result.scenario = &scenario;
+        result.threads = threads.getThreadCount();
+        result.substeps = options.substeps;
+        result.hz = options.hz;
+        result.warmup = options.warmup >= 0 ? options.warmup : (int)std::lround(scenario.warmupSeconds * options.hz);
+
+        for (int s = 0; s < result.warmup; ++s) physics.step(threads, particles);
+
+        result.setupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - setupStart).count();
+
+        std::vector<double> samples[6];
+        for (std::vector<double>& stage : samples) stage.reserve(options.substeps);
+
+        double contactSum = 0.0;
+
+        for (int s = 0; s < options.substeps; ++s)
+        {
+            physics.step(threads, particles);
+
+            const PhysicsTimings& t = physics.getTimings();
+            samples[0].push_back(t.reorder);
+            samples[1].push_back(t.integrate);
+            samples[2].push_back(t.broadphase);
+            samples[3].push_back(t.narrowphase);
+            samples[4].push_back(t.sleep);
+            samples[5].push_back(t.total);
+            contactSum += physics.getContactCount();
+        }
+
+        for (int k = 0; k < 6; ++k) result.stages[k] = summarize(std::move(samples[k]));
+
+        result.meanContacts = contactSum / options.substeps;
+        result.awakeAtEnd = physics.getAwakeCount();
+        result.digest = stateDigest(particles);
+        return result;
+    }
+}
+//--RUN-END--
+
+//--REPORT--
+namespace
+{
+    void writeCsv(std::FILE* f, const std::vector<Result>& results)
+    {
+        std::fprintf(f, "scenario,spheres,threads,hz,warmup,substeps,stage,mean_ms,p50_ms,p95_ms,max_ms,mean_contacts,awake_at_end,digest\n");
+
+        for (const Result& r : results)
+        {
+            for (int k = 0; k < 6; ++k)
+            {
+                const StageStats& s = r.stages[k];
+                std::fprintf(f, "%s,%d,%d,%g,%d,%d,%s,%.4f,%.4f,%.4f,%.4f,%.1f,%d,%016llx\n",
+                             r.scenario->name, r.scenario->count, r.threads, r.hz, r.warmup, r.substeps, STAGE_NAMES[k],
+                             s.mean, s.p50, s.p95, s.max, r.meanContacts, r.awakeAtEnd, (unsigned long long)r.digest);
+            }
+        }
+    }
+
+    void writeJson(std::FILE* f, const std::vector<Result>& results)
+    {
+        std::fprintf(f, "[\n");
+
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result& r = results[i];
+            std::fprintf(f, "  {\n    \"scenario\": \"%s\", \"spheres\": %d, \"threads\": %d, \"hz\": %g, \"warmup\": %d, \"substeps\": %d,\n",
+                         r.scenario->name, r.scenario->count, r.threads, r.hz, r.warmup, r.substeps);
+            std::fprintf(f, "    \"setup_ms\": %.1f, \"mean_contacts\": %.1f, \"awake_at_end\": %d, \"digest\": \"%016llx\",\n",
+                         r.setupMs, r.meanContacts, r.awakeAtEnd, (unsigned long long)r.digest);
+            std::fprintf(f, "    \"stages_ms\": {\n");
+
+            for (int k = 0; k < 6; ++k)
+            {
+                const StageStats& s = r.stages[k];
+                std::fprintf(f, "      \"%s\": { \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"max\": %.4f }%s\n",
+                             STAGE_NAMES[k], s.mean, s.p50, s.p95, s.max, k < 5 ? "," : "");
+            }
+
+            std::fprintf(f, "    }\n  }%s\n", i + 1 < results.size() ? "," : "");
+        }
+
+        std::fprintf(f, "]\n");
+    }
+}
+//--REPORT-END--
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    ThreadSystem threads(options.threads);
+    std::vector<Result> results;
+
+    for (const std::string& name : options.scenarios)
+    {
+        const Scenario& scenario = *findScenario(name);
+        std::fprintf(stderr, "%s: %d spheres, %d threads...\n", scenario.name, scenario.count, threads.getThreadCount());
+        results.push_back(runScenario(scenario, options, threads));
+    }
+
+    std::FILE* f = options.out.empty() ? stdout : std::fopen(options.out.c_str(), "w");
+    if (!f)
+    {
+        std::fprintf(stderr, "cannot open %s\n", options.out.c_str());
+        return 1;
+    }
+
+    if (options.json) writeJson(f, results);
+    else writeCsv(f, results);
+
+    if (f != stdout) std::fclose(f);
+
+    //--CHECK--
+    int failed = 0;
+
+    for (const Result& r : results)
+    {
+        const int limit = r.scenario->maxAwakeAtEnd;
+        if (!options.check || limit < 0 || options.solverMode != SolverMode::ContactList) continue; //Only the contact list sleeps.
+
+        const bool ok = r.awakeAtEnd >= 0 && r.awakeAtEnd <= limit;
+        std::fprintf(stderr, "check %s: %d awake at end (limit %d after %d warmup substeps) %s\n",
+                     r.scenario->name, r.awakeAtEnd, limit, r.warmup, ok ? "ok" : "FAILED");
+        failed += !ok;
+    }
+    //--CHECK-END--
+
+    return failed ? 2 : 0;
+}
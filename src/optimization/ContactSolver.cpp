@@ -0,0 +1,292 @@
+/*
+    Contact solver implementation: colored contact emission, warm start cache, and impulse iterations.
+*/
+
+#include "ContactSolver.h"
+#include "UniformGrid.h"
+#include "HierarchicalGrid.h"
+#include "SweepAndPrune.h"
+#include "LinearBvh.h"
+#include "../scene/ParticleStore.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+    inline std::uint32_t hashKey(std::uint64_t key)
+    {
+        key *= 0x9E3779B97F4A7C15ull; //Fibonacci hashing, high bits are well mixed.
+        return static_cast<std::uint32_t>(key >> 32);
+    }
+}
+
+template<typename Fn>
+void ContactSolver::forEachBatch(ThreadSystem& tasks, Fn&& fn)
+{
+    for (int color = 0; color < (int)colorContactCount.size(); ++color)
+    {
+        if (colorContactCount[color] == 0) continue;
+
+        tasks.parallelFor(0, slotsPerColor, 1, [&](int s0, int s1, int)
+        {
+            for (int slot = s0; slot < s1; ++slot)
+            {
+                for (Contact& c : batches[color * slotsPerColor + slot]) fn(c); //Batches of one color never share spheres.
+            }
+        }); //Blocking, acts as the barrier between color classes.
+    }
+}
+
+template<typename Grid>
+void ContactSolver::build(ThreadSystem& tasks, const Grid& grid, const ParticleStore& particles, const ContactSolverSettings& settings)
+{
+    const int COLORS = grid.getColorCount();
+
+    slotsPerColor = tasks.getThreadCount(); //parallelFor never splits into more chunks than workers.
+    if ((int)batches.size() != COLORS * slotsPerColor) batches.resize(COLORS * slotsPerColor);
+    for (auto& batch : batches) batch.clear(); //Keeps capacity across substeps.
+
+    colorContactCount.assign(COLORS, 0);
+    contactCount = 0;
+
+    if (!grid.hasColorClasses()) return;
+
+    const float* pX = particles.px.data(); const float* pY = particles.py.data(); const float* pZ = particles.pz.data();
+    const float* vX = particles.vx.data(); const float* vY = particles.vy.data(); const float* vZ = particles.vz.data();
+    const float* rad = particles.radius.data();
+
+    auto getPos = [&](int id) -> glm::vec3 { return glm::vec3(pX[id], pY[id], pZ[id]); };
+    auto getRad = [&](int id) -> float { return rad[id]; };
+
+    for (int color = 0; color < COLORS; ++color)
+    {
+        //--CONTACT-EMISSION--
+        tasks.parallelFor(grid.getColorClassBegin(color), grid.getColorClassEnd(color), 16, [&](int i0, int i1, int k)
+        {
+            std::vector<Contact>& out = batches[color * slotsPerColor + k];
+
+            auto emit = [&](int a, int b)
+            {
+                if (a > b) std::swap(a, b); //Canonical order for the pair key.
+
+                const float dx = pX[a] - pX[b], dy = pY[a] - pY[b], dz = pZ[a] - pZ[b];
+                const float d2 = dx * dx + dy * dy + dz * dz;
+                const float reach = rad[a] + rad[b] + settings.margin;
+
+                if (d2 >= reach * reach) return; //Not touching and not about to.
+
+                const float distance = std::sqrt(std::max(d2, 1e-8f));
+                const float inv = (distance > 1e-6f) ? 1.0f / distance : 0.0f;
+                const float nx = (inv > 0.0f) ? dx * inv : 1.0f, ny = dy * inv, nz = dz * inv;
+
+                const float vn = (vX[a] - vX[b]) * nx + (vY[a] - vY[b]) * ny + (vZ[a] - vZ[b]) * nz;
+                const float target = (vn < -settings.bounceThreshold) ? -settings.restitution * vn : 0.0f; //Only real impacts bounce.
+
+                out.push_back(Contact{ a, b, cachedImpulse(pairKey(a, b)) * settings.warmStart, target });
+            };
+
+            for (int idx = i0; idx < i1; ++idx)
+            {
+                grid.forEachPotentialPairInColorCell(idx, getPos, getRad, emit);
+            }
+        });
+        //--CONTACT-EMISSION-END--
+
+        for (int slot = 0; slot < slotsPerColor; ++slot)
+        {
+            colorContactCount[color] += (int)batches[color * slotsPerColor + slot].size();
+        }
+
+        contactCount += colorContactCount[color];
+    }
+}
+
+template void ContactSolver::build<UniformGrid>(ThreadSystem&, const UniformGrid&, const ParticleStore&, const ContactSolverSettings&);
+template void ContactSolver::build<HierarchicalGrid>(ThreadSystem&, const HierarchicalGrid&, const ParticleStore&, const ContactSolverSettings&);
+template void ContactSolver::build<SweepAndPrune>(ThreadSystem&, const SweepAndPrune&, const ParticleStore&, const ContactSolverSettings&);
+template void ContactSolver::build<LinearBvh>(ThreadSystem&, const LinearBvh&, const ParticleStore&, const ContactSolverSettings&);
+template void ContactSolver::build<LayeredGridPairs>(ThreadSystem&, const LayeredGridPairs&, const ParticleStore&, const ContactSolverSettings&);
+
+void ContactSolver::solve(ThreadSystem& tasks, ParticleStore& particles, const ContactSolverSettings& settings)
+{
+    if (contactCount == 0)
+    {
+        storeImpulses();
+        return;
+    }
+
+    float* pX = particles.px.data(); float* pY = particles.py.data(); float* pZ = particles.pz.data();
+    float* vX = particles.vx.data(); float* vY = particles.vy.data(); float* vZ = particles.vz.data();
+    const float* rad = particles.radius.data();
+    const float* invMass = particles.invMass.data();
+    const float* awake = particles.awake.data();
+
+    const float invDt = 1.0f / settings.dt;
+    const float mu = settings.friction;
+
+    //Current contact normal (b -> a) from live positions.
+    auto normalOf = [&](const Contact& c, float& nx, float& ny, float& nz) -> float
+    {
+        const float dx = pX[c.a] - pX[c.b], dy = pY[c.a] - pY[c.b], dz = pZ[c.a] - pZ[c.b];
+        const float distance = std::sqrt(std::max(dx * dx + dy * dy + dz * dz, 1e-8f));
+
+        if (distance > 1e-6f) { const float inv = 1.0f / distance; nx = dx * inv; ny = dy * inv; nz = dz * inv; }
+        else { nx = 1.0f; ny = 0.0f; nz = 0.0f; } //Fallback axis if overlapping too much.
+
+        return distance;
+    };
+
+    //--WARM-START--
+    forEachBatch(tasks, [&](Contact& c)
+    {
+        if (c.normalImpulse <= 0.0f) return;
+        if (awake[c.a] == 0.0f && awake[c.b] == 0.0f) return; //Both asleep: kept for islands only.
+
+        float nx, ny, nz;
+        normalOf(c, nx, ny, nz);
+
+        const float ia = c.normalImpulse * invMass[c.a] * awake[c.a]; //Sleepers are immovable until their island wakes.
+        const float ib = c.normalImpulse * invMass[c.b] * awake[c.b];
+        if (ia > 0.0f) { vX[c.a] += nx * ia; vY[c.a] += ny * ia; vZ[c.a] += nz * ia; }
+        if (ib > 0.0f) { vX[c.b] -= nx * ib; vY[c.b] -= ny * ib; vZ[c.b] -= nz * ib; }
+    });
+    //--WARM-START-END--
+
+    //--IMPULSE-ITERATIONS--
+    for (int iter = 0; iter < settings.iterations; ++iter)
+    {
+        forEachBatch(tasks, [&](Contact& c)
+        {
+            const int a = c.a, b = c.b;
+            if (awake[a] == 0.0f && awake[b] == 0.0f) return;
+
+            float nx, ny, nz;
+            const float distance = normalOf(c, nx, ny, nz);
+            const float penetration = rad[a] + rad[b] - distance;
+
+            const float invA = invMass[a] * awake[a], invB = invMass[b] * awake[b]; //A sleeper acts as a static sphere.
+            const float invSum = invA + invB;
+
+            //Positional correction, same split as the direct solver (80% of overlap past a small slop).
+            const float percent = 0.8f;
+            const float slop = 0.001f;
+
+            if (penetration > slop)
+            {
+                const float corr = (penetration - slop) / invSum * percent;
+                if (invA > 0.0f) { pX[a] += nx * corr * invA; pY[a] += ny * corr * invA; pZ[a] += nz * corr * invA; }
+                if (invB > 0.0f) { pX[b] -= nx * corr * invB; pY[b] -= ny * corr * invB; pZ[b] -= nz * corr * invB; }
+            }
+
+            const float rvx = vX[a] - vX[b], rvy = vY[a] - vY[b], rvz = vZ[a] - vZ[b];
+            const float vn = rvx * nx + rvy * ny + rvz * nz;
+
+            //Speculative when separated: allow closing exactly the gap this substep, no more.
+            const float desired = (penetration < 0.0f) ? penetration * invDt : c.targetVelocity;
+
+            const float oldImpulse = c.normalImpulse;
+            c.normalImpulse = std::max(oldImpulse + (desired - vn) / invSum, 0.0f); //Accumulated impulse stays >= 0.
+            const float dj = c.normalImpulse - oldImpulse;
+
+            float ix = nx * dj, iy = ny * dj, iz = nz * dj;
+
+            //--TINY-TANGENTIAL-FRICTION--
+            const float tx = rvx - nx * vn, ty = rvy - ny * vn, tz = rvz - nz * vn;
+            const float t2 = tx * tx + ty * ty + tz * tz;
+
+            if (t2 > 1e-12f && c.normalImpulse > 0.0f)
+            {
+                const float tLen = std::sqrt(t2);
+                const float jt = std::min(tLen / invSum, mu * c.normalImpulse); //Coulomb clamp on the accumulated normal impulse.
+                const float s = -jt / tLen;
+                ix += tx * s; iy += ty * s; iz += tz * s;
+            }
+            //--TINY-TANGENTIAL-FRICTION-END--
+
+            if (invA > 0.0f) { vX[a] += ix * invA; vY[a] += iy * invA; vZ[a] += iz * invA; }
+            if (invB > 0.0f) { vX[b] -= ix * invB; vY[b] -= iy * invB; vZ[b] -= iz * invB; } //Never written: may sit in other batches.
+        });
+    }
+    //--IMPULSE-ITERATIONS-END--
+
+    storeImpulses();
+}
+
+void ContactSolver::storeImpulses()
+{
+    //--WARM-START-CACHE-FILL--
+    std::uint32_t capacity = 1024;
+    while (capacity < (std::uint32_t)contactCount * 2u) capacity <<= 1; //Load factor <= 0.5 keeps probes short.
+
+    cacheKeys.assign(capacity, EMPTY_KEY);
+    cacheImpulses.resize(capacity);
+    cacheMask = capacity - 1;
+
+    for (const auto& batch : batches)
+    {
+        for (const Contact& c : batch)
+        {
+            if (c.normalImpulse <= 0.0f) continue; //Only pairs that actually pushed are worth warm starting.
+
+            const std::uint64_t key = pairKey(c.a, c.b);
+            std::uint32_t slot = hashKey(key) & cacheMask;
+
+            while (cacheKeys[slot] != EMPTY_KEY) slot = (slot + 1) & cacheMask;
+
+            cacheKeys[slot] = key;
+            cacheImpulses[slot] = c.normalImpulse;
+        }
+    }
+    //--WARM-START-CACHE-FILL-END--
+}
+
+float ContactSolver::cachedImpulse(std::uint64_t key) const
+{
+    if (cacheKeys.empty()) return 0.0f;
+
+    std::uint32_t slot = hashKey(key) & cacheMask;
+
+    while (cacheKeys[slot] != EMPTY_KEY)
+    {
+        if (cacheKeys[slot] == key) return cacheImpulses[slot];
+        slot = (slot + 1) & cacheMask;
+    }
+
+    return 0.0f;
+}
+
+
+void ContactSolver::remapIds(const std::vector<int>& oldToNew)
+{
+    //--WARM-START-CACHE-REMAP--
+    std::vector<std::uint64_t> oldKeys;
+    std::vector<float> oldImpulses;
+    oldKeys.swap(cacheKeys);
+    oldImpulses.swap(cacheImpulses);
+
+    cacheKeys.assign(oldKeys.size(), EMPTY_KEY);
+    cacheImpulses.resize(oldKeys.size());
+
+    for (size_t i = 0; i < oldKeys.size(); ++i)
+    {
+        if (oldKeys[i] == EMPTY_KEY) continue;
+
+        int a = oldToNew[static_cast<std::uint32_t>(oldKeys[i] >> 32)];
+        int b = oldToNew[static_cast<std::uint32_t>(oldKeys[i])];
+        if (a > b) std::swap(a, b); //Keep the canonical (a < b) order under the new ids.
+
+        const std::uint64_t key = pairKey(a, b);
+        std::uint32_t slot = hashKey(key) & cacheMask;
+
+        while (cacheKeys[slot] != EMPTY_KEY) slot = (slot + 1) & cacheMask;
+
+        cacheKeys[slot] = key;
+        cacheImpulses[slot] = oldImpulses[i];
+    }
+    //--WARM-START-CACHE-REMAP-END--
+
+    for (auto& batch : batches) batch.clear(); //Batches hold old ids, the next build refills them.
+    colorContactCount.assign(colorContactCount.size(), 0);
+    contactCount = 0;
+}
\ No newline at end of file
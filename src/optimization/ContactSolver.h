@@ -0,0 +1,89 @@
+/*
+    Contact solver header: per-substep contact list, warm-started sequential impulses over colored batches.
+*/
+
+#pragma once
+
+#include "ThreadSystem.h"
+
+#include <vector>
+#include <cstdint>
+
+class ParticleStore;
+class UniformGrid;
+class HierarchicalGrid;
+class SweepAndPrune;
+class LinearBvh;
+struct LayeredGridPairs;
+
+//Tunables for one substep of the contact solver.
+struct ContactSolverSettings
+{
+    int iterations = 4;             //Solver passes over the same contact list.
+    float dt = 1.0f / 240.0f;       //Substep length (speculative contacts + restitution).
+    float restitution = 0.9f;       //Bounciness for sphere-sphere collisions.
+    float bounceThreshold = 0.5f;   //Approach speeds below this do not bounce, so piles can come to rest.
+    float friction = 0.02f;         //Very small Coulomb friction to damp sliding.
+    float margin = 0.05f;           //Extra gap for which a pair is still kept as a (speculative) contact.
+    float warmStart = 0.85f;        //Fraction of last substep's impulse applied up front.
+};
+
+//Broadphase runs once per substep (build), the solver then iterates the compact list N times (solve).
+//Contacts are emitted per grid color class and per parallelFor chunk; chunks of one class never share
+//a sphere, so every batch can be solved in parallel without locks. Sleeping spheres (awake == 0) are the
+//exception: they get no inverse mass and are only ever read, so they may appear in several batches.
+//Accumulated impulses are cached by pair key and used to warm start the same pair next substep.
+class ContactSolver
+{
+public:
+    //Grid is any colored pair source (UniformGrid, HierarchicalGrid, SweepAndPrune, LinearBvh, LayeredGridPairs): getColorCount,
+    //getColorClassBegin/End, hasColorClasses and forEachPotentialPairInColorCell. Instantiated for each in the .cpp.
+    template<typename Grid>
+    void build(ThreadSystem& tasks, const Grid& grid, const ParticleStore& particles, const ContactSolverSettings& settings);
+    void solve(ThreadSystem& tasks, ParticleStore& particles, const ContactSolverSettings& settings);
+
+    int getContactCount() const { return contactCount; }
+
+    //Visit every contact pair (a, b) of the last build in parallel, in no particular order.
+    template<typename Fn>
+    void forEachContactParallel(ThreadSystem& tasks, Fn&& fn) const
+    {
+        tasks.parallelFor(0, (int)batches.size(), 1, [&](int b0, int b1, int)
+        {
+            for (int b = b0; b < b1; ++b)
+            {
+                for (const Contact& c : batches[b]) fn(c.a, c.b);
+            }
+        });
+    }
+
+    void remapIds(const std::vector<int>& oldToNew);   //Rewrite cached pair keys after particles were permuted.
+
+private:
+    struct Contact
+    {
+        int a, b;                   //Sphere ids, a < b.
+        float normalImpulse;        //Accumulated normal impulse (>= 0).
+        float targetVelocity;       //Separating velocity we aim for (restitution bounce).
+    };
+
+    template<typename Fn>
+    void forEachBatch(ThreadSystem& tasks, Fn&& fn);   //Color by color, batches of one color in parallel.
+
+    void storeImpulses();                              //Refill the warm-start cache from this substep's contacts.
+    float cachedImpulse(std::uint64_t key) const;      //0 if the pair was not in contact last substep.
+
+    static std::uint64_t pairKey(int a, int b) { return (std::uint64_t(std::uint32_t(a)) << 32) | std::uint32_t(b); }
+
+    std::vector<std::vector<Contact>> batches;  //[color * slotsPerColor + chunk].
+    std::vector<int> colorContactCount;         //Contacts per color class (skip empty classes).
+    int slotsPerColor = 0;
+    int contactCount = 0;
+
+    //--WARM-START-CACHE--
+    std::vector<std::uint64_t> cacheKeys;       //Open addressing, linear probing. EMPTY_KEY marks free slots.
+    std::vector<float> cacheImpulses;
+    std::uint32_t cacheMask = 0;
+    static constexpr std::uint64_t EMPTY_KEY = ~0ull;
+    //--WARM-START-CACHE-END--
+};
@@ -27,15 +27,33 @@ void extractFrustumPlanes(const glm::mat4& mutex, FrustumPlane out[6])
 
 bool sphereIntersectsFrustum(const FrustumPlane planes[6], const glm::vec3& c, float r)
 {
-    const float eps = 1e-4f; //Tiny bias to avoid borderline popping from FP noise.
-
     for (int i = 0; i < 6; ++i)
     {
         float dist = glm::dot(planes[i].n, c) + planes[i].d; //Signed distance to plane.
 
-        if (dist < -(r + eps)) return false; //Completely outside this plane.
+        if (dist < -(r + FRUSTUM_EPS)) return false; //Completely outside this plane.
     }
 
     return true; //Inside or intersecting.
 }
+
+FrustumOverlap boxOverlapsFrustum(const FrustumPlane planes[6], const glm::vec3& lo, const glm::vec3& hi)
+{
+    const glm::vec3 center = (lo + hi) * 0.5f;
+    const glm::vec3 extent = (hi - lo) * 0.5f;
+    bool inside = true;
+
+    for (int i = 0; i < 6; ++i)
+    {
+        const float dist = glm::dot(planes[i].n, center) + planes[i].d;
+        const float reach = glm::dot(glm::abs(planes[i].n), extent); //Box half-width along the normal.
+
+        //Margins of one FRUSTUM_EPS past the per-sphere test absorb rounding, so for a box that bounds spheres
+        //both verdicts agree with sphereIntersectsFrustum on every sphere inside it.
+        if (dist + reach < -2.0f * FRUSTUM_EPS) return FrustumOverlap::Outside;
+        if (dist - reach < FRUSTUM_EPS) inside = false;
+    }
+
+    return inside ? FrustumOverlap::Inside : FrustumOverlap::Straddle;
+}
 //--FRUSTUM-PLANES-HELPERS-END--
\ No newline at end of file
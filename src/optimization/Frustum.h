@@ -8,7 +8,11 @@
 
 //--FRUSTUM-PLANES-HELPERS--
 struct FrustumPlane { glm::vec3 n; float d; }; //Plane: n.x * x + n.y * y + n.z * z + d = 0
+constexpr float FRUSTUM_EPS = 1e-4f; //Tiny bias to avoid borderline popping from FP noise, shared with the batched cull.
 FrustumPlane normalizePlane(FrustumPlane p);
 void extractFrustumPlanes(const glm::mat4& mutex, FrustumPlane out[6]);
 bool sphereIntersectsFrustum(const FrustumPlane planes[6], const glm::vec3& c, float r); //Sphere vs frustum test.
+
+enum class FrustumOverlap { Outside, Straddle, Inside };
+FrustumOverlap boxOverlapsFrustum(const FrustumPlane planes[6], const glm::vec3& lo, const glm::vec3& hi); //AABB vs frustum, for whole blocks.
 //--FRUSTUM-PLANES-HELPERS-END--
\ No newline at end of file
@@ -0,0 +1,141 @@
+/*
+    Hierarchical grid implementation: radius classification, per-level subset builds, 27-class coloring.
+*/
+
+#include "HierarchicalGrid.h"
+#include "../scene/ParticleStore.h"
+
+#include <algorithm>
+
+void HierarchicalGrid::resize(const glm::vec3& boxMin, const glm::vec3& boxMax, float minRadius, float maxRadius)
+{
+    this->boxMin = boxMin;
+    this->boxMax = boxMax;
+    baseCell = std::max(2.0f * minRadius, 1e-6f); //Finest cell holds the smallest diameter.
+
+    levelCount = 1;
+    float cell = baseCell;
+    while (cell < 2.0f * maxRadius && levelCount < MAX_LEVELS) { cell *= 2.0f; ++levelCount; } //One level per octave of radius.
+
+    cell = baseCell;
+    for (int level = 0; level < levelCount; ++level)
+    {
+        levels[level].resize(boxMin, boxMax, cell);
+        crossLevels[level].resize(boxMin, boxMax, cell); //Same dims as levels[level], so cell coordinates line up.
+        levelIds[level].clear();
+        finerIds[level].clear();
+        cell *= 2.0f;
+    }
+
+    colorCells.clear();
+    colorStart.clear();
+}
+
+void HierarchicalGrid::setDeterministic(bool on)
+{
+    for (int level = 0; level < MAX_LEVELS; ++level)
+    {
+        levels[level].setDeterministic(on);
+        crossLevels[level].setDeterministic(on);
+    }
+}
+
+int HierarchicalGrid::levelOf(float radius) const
+{
+    int level = 0;
+    float cell = baseCell;
+
+    while (cell < 2.0f * radius && level < levelCount - 1) { cell *= 2.0f; ++level; }
+
+    return level;
+}
+
+void HierarchicalGrid::build(ThreadSystem& tasks, const ParticleStore& particles)
+{
+    if (levelCount <= 0) return;
+
+    const int count = particles.size();
+    const int chunkSlots = tasks.getThreadCount();
+    const int MIN_GRAIN = 4096;
+
+    //--CLASSIFY-BY-RADIUS-- (per-chunk lists, merged in chunk order so ids stay ascending)
+    chunkLevelIds.resize(static_cast<size_t>(chunkSlots) * MAX_LEVELS);
+    for (auto& list : chunkLevelIds) list.clear();
+
+    const float* rad = particles.radius.data();
+
+    tasks.parallelFor(0, count, MIN_GRAIN, [&](int i0, int i1, int k)
+    {
+        for (int i = i0; i < i1; ++i) chunkLevelIds[k * MAX_LEVELS + levelOf(rad[i])].push_back(i);
+    });
+
+    for (int level = 0; level < levelCount; ++level)
+    {
+        std::vector<int>& ids = levelIds[level];
+        ids.clear();
+        for (int k = 0; k < chunkSlots; ++k)
+        {
+            const std::vector<int>& part = chunkLevelIds[k * MAX_LEVELS + level];
+            ids.insert(ids.end(), part.begin(), part.end());
+        }
+
+        if (level > 0) //Finer ids for the cross-level grid: levels 0..level-1.
+        {
+            finerIds[level] = finerIds[level - 1];
+            finerIds[level].insert(finerIds[level].end(), levelIds[level - 1].begin(), levelIds[level - 1].end());
+        }
+    }
+    //--CLASSIFY-BY-RADIUS-END--
+
+    //--LEVEL-BUILDS--
+    for (int level = 0; level < levelCount; ++level)
+    {
+        levels[level].build(tasks, particles, &levelIds[level]);
+        if (level > 0 && !levelIds[level].empty()) crossLevels[level].build(tasks, particles, &finerIds[level]); //Only queried from level cells.
+    }
+    //--LEVEL-BUILDS-END--
+
+    buildColorClasses();
+}
+
+void HierarchicalGrid::buildColorClasses()
+{
+    //--COLOR-COUNTING-SORT-- (per level, 27 classes, stable so activation order is kept)
+    const int colorCount = getColorCount();
+    colorStart.assign(colorCount + 1, 0);
+
+    int total = 0;
+    for (int level = 0; level < levelCount; ++level) total += levels[level].getActiveCellCount();
+    colorCells.resize(total);
+
+    auto classOf = [&](const UniformGrid& grid, int linearCellId)
+    {
+        int cellX, cellY, cellZ;
+        grid.getCellCoords(linearCellId, cellX, cellY, cellZ);
+        return (cellX % 3) + 3 * (cellY % 3) + 9 * (cellZ % 3);
+    };
+
+    for (int level = 0; level < levelCount; ++level)
+    {
+        const UniformGrid& grid = levels[level];
+        for (int idx = 0; idx < grid.getActiveCellCount(); ++idx)
+        {
+            ++colorStart[level * LEVEL_COLOR_COUNT + classOf(grid, grid.getActiveCell(idx)) + 1];
+        }
+    }
+
+    for (int c = 0; c < colorCount; ++c) colorStart[c + 1] += colorStart[c]; //Exclusive prefix sum.
+
+    std::vector<int> cursor(colorStart.begin(), colorStart.end() - 1);
+
+    for (int level = 0; level < levelCount; ++level)
+    {
+        const UniformGrid& grid = levels[level];
+        for (int idx = 0; idx < grid.getActiveCellCount(); ++idx)
+        {
+            const int linearCellId = grid.getActiveCell(idx);
+            colorCells[cursor[level * LEVEL_COLOR_COUNT + classOf(grid, linearCellId)]++] = linearCellId;
+        }
+    }
+    //--COLOR-COUNTING-SORT-END--
+}
@@ -0,0 +1,170 @@
+/*
+    Hierarchical grid header: one UniformGrid level per power-of-two radius class, plus cross-level pairs.
+*/
+
+#pragma once
+
+#include "UniformGrid.h"
+#include "ThreadSystem.h"
+
+#include <glm.hpp>
+#include <array>
+#include <vector>
+#include <cmath>
+
+class ParticleStore;
+
+//Broadphase for mixed radii. Level L has cell size baseCell * 2^L (baseCell = smallest diameter) and holds
+//the spheres whose diameter fits that cell, so every level keeps the single neighbour ring assumption and
+//per-cell counts stay small. Same-level pairs come from each level's pruned half-shell. Cross-level pairs
+//are found from the coarse side: crossLevels[M] bins every finer sphere at level M's cell size, and a finer
+//sphere that can reach a level-M sphere is less than one level-M cell away, so 27 cells cover it.
+//
+//Colors: each level's active cells are split into 27 classes (x%3, y%3, z%3). A cell only touches its
+//27-neighbourhood and two cells of one class are 3 cells apart, so a class runs without locks. Levels run
+//one after another: color index = level * LEVEL_COLOR_COUNT + class.
+class HierarchicalGrid
+{
+public:
+    static constexpr int MAX_LEVELS = 8;
+    static constexpr int LEVEL_COLOR_COUNT = 27;
+
+    void resize(const glm::vec3& boxMin, const glm::vec3& boxMax, float minRadius, float maxRadius); //Levels from the radius range.
+    void build(ThreadSystem& tasks, const ParticleStore& particles);                                 //Classify by radius, build every level.
+    void setDeterministic(bool on);                                                                  //Forwarded to every level.
+
+    int levelOf(float radius) const;    //Smallest level whose cell holds the diameter (clamped to the top level).
+    int getLevelCount() const { return levelCount; }
+    int getLevelSize(int level) const { return static_cast<int>(levelIds[level].size()); }
+    const UniformGrid& getLevel(int level) const { return levels[level]; }
+
+    float getCellSize() const { return baseCell; } //Finest cell size (spatial reorder keys).
+    const glm::vec3& getBoxMin() const { return boxMin; }
+
+    //--COLORED-SOURCE-- (same shape as UniformGrid's, consumed by ContactSolver::build)
+    int getColorCount() const { return levelCount * LEVEL_COLOR_COUNT; }
+    bool hasColorClasses() const { return levelCount > 0 && (int)colorStart.size() == getColorCount() + 1; }
+    int getColorClassBegin(int color) const { return colorStart[color]; }
+    int getColorClassEnd(int color) const { return colorStart[color + 1]; }
+
+    template<typename GetPos, typename GetRad, typename Fn>
+    void forEachPotentialPairInColorCell(int idx, GetPos& getPos, GetRad& getRad, Fn& fn) const
+    {
+        const int level = colorLevel(idx);
+        const int linearCellId = colorCells[idx];
+
+        levels[level].forEachPotentialPairInCell(linearCellId, getPos, getRad, fn);  //Same size class.
+        if (level > 0) visitCrossLevel(level, linearCellId, getPos, getRad, fn);     //Against every finer class.
+    }
+    //--COLORED-SOURCE-END--
+
+    //All pairs, every level in parallel over its active cells (fn must synchronize, e.g. per-sphere locks).
+    template<typename GetPos, typename GetRad, typename Fn>
+    void forEachPotentialPairPrunedParallel(ThreadSystem& tasks, GetPos getPos, GetRad getRad, Fn&& fn) const
+    {
+        const int MIN_GRAIN = 16;
+
+        for (int level = 0; level < levelCount; ++level)
+        {
+            const UniformGrid& grid = levels[level];
+
+            tasks.parallelFor(0, grid.getActiveCellCount(), MIN_GRAIN, [&](int begin, int end, int)
+            {
+                for (int idx = begin; idx < end; ++idx)
+                {
+                    const int linearCellId = grid.getActiveCell(idx);
+                    grid.forEachPotentialPairInCell(linearCellId, getPos, getRad, fn);
+                    if (level > 0) visitCrossLevel(level, linearCellId, getPos, getRad, fn);
+                }
+            });
+        }
+    }
+
+    //Lock-free variant: one color class at a time, parallel inside the class.
+    template<typename GetPos, typename GetRad, typename Fn>
+    void forEachPotentialPairColoredParallel(ThreadSystem& tasks, GetPos getPos, GetRad getRad, Fn&& fn) const
+    {
+        if (!hasColorClasses()) return;
+
+        const int MIN_GRAIN = 16;
+
+        for (int color = 0; color < getColorCount(); ++color)
+        {
+            tasks.parallelFor(colorStart[color], colorStart[color + 1], MIN_GRAIN, [&](int begin, int end, int)
+            {
+                for (int idx = begin; idx < end; ++idx) forEachPotentialPairInColorCell(idx, getPos, getRad, fn);
+            }); //parallelFor blocks, which is the barrier between classes.
+        }
+    }
+
+private:
+    //Level-M spheres of one cell against the finer spheres binned around it at level-M resolution. Each sphere
+    //only visits the cells its reach box overlaps (own radius + largest finer radius, a quarter cell), which
+    //is usually 2 cells per axis and never leaves the 27-neighbourhood the coloring relies on.
+    template<typename GetPos, typename GetRad, typename Fn>
+    void visitCrossLevel(int level, int linearCellId, GetPos& getPos, GetRad& getRad, Fn& fn) const
+    {
+        const UniformGrid& coarse = levels[level];
+        const UniformGrid& finer = crossLevels[level];
+        const float cell = coarse.getCellSize();
+        const float invCell = 1.0f / cell;
+        const float finerReach = 0.25f * cell;
+
+        int cellX, cellY, cellZ;
+        coarse.getCellCoords(linearCellId, cellX, cellY, cellZ);
+        const glm::ivec3 home(cellX, cellY, cellZ);
+
+        for (int objectA : coarse.getCellObjects(cellX, cellY, cellZ))
+        {
+            const glm::vec3 posA = getPos(objectA);
+            const float radA = getRad(objectA);
+            const glm::vec3 local = (posA - boxMin) * invCell;
+            const float reachCells = (radA + finerReach) * invCell;
+
+            const glm::ivec3 lo = glm::clamp(glm::ivec3(glm::floor(local - reachCells)), home - 1, home + 1);
+            const glm::ivec3 hi = glm::clamp(glm::ivec3(glm::floor(local + reachCells)), home - 1, home + 1);
+
+            for (int z = lo.z; z <= hi.z; ++z)
+            {
+                for (int y = lo.y; y <= hi.y; ++y)
+                {
+                    for (int x = lo.x; x <= hi.x; ++x)
+                    {
+                        for (int objectB : finer.getCellObjects(x, y, z))
+                        {
+                            const glm::vec3 d = getPos(objectB) - posA;
+                            const float reach = radA + getRad(objectB);
+
+                            if (std::abs(d.x) <= reach && std::abs(d.y) <= reach && std::abs(d.z) <= reach)
+                            {
+                                fn(objectA, objectB); //Box reject only, the narrow phase does the exact test.
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    int colorLevel(int idx) const
+    {
+        int level = 0;
+        while (idx >= colorStart[(level + 1) * LEVEL_COLOR_COUNT]) ++level; //At most MAX_LEVELS steps.
+        return level;
+    }
+
+    void buildColorClasses();
+
+    glm::vec3 boxMin{ 0.0f }, boxMax{ 0.0f };
+    float baseCell = 1.0f;
+    int levelCount = 0;
+
+    std::array<UniformGrid, MAX_LEVELS> levels;             //Level L: spheres of size class L.
+    std::array<UniformGrid, MAX_LEVELS> crossLevels;        //[M]: every sphere of levels < M, at level M's cell size.
+    std::array<std::vector<int>, MAX_LEVELS> levelIds;      //Sphere ids per size class (ascending).
+    std::array<std::vector<int>, MAX_LEVELS> finerIds;      //[M]: ids of levels 0..M-1.
+    std::vector<std::vector<int>> chunkLevelIds;            //[chunk * MAX_LEVELS + level], merged into levelIds.
+
+    std::vector<int> colorCells;                            //Active cells grouped by (level, class).
+    std::vector<int> colorStart;                            //Color c owns colorCells[colorStart[c], colorStart[c + 1]).
+};
@@ -3,11 +3,14 @@
 */
 
 #include "Instance.h"
-#include "../scene/Sphere.h"
+#include "../scene/ParticleStore.h"
+#include "../scene/RenderSnapshot.h"
 
 #include <gtc/type_ptr.hpp>
 #include <gtc/packing.hpp>
 #include <vector>
+#include <unordered_map>
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <cstring>
@@ -24,13 +27,25 @@ namespace
         std::uint16_t angle;    //2 (half)
         std::uint16_t pad = 0;  //2
     };
+
+    //Gather one particle from the SoA streams into the packed instance layout. RenderState::getPosition
+    //interpolates between the last two physics steps, ParticleStore's is the raw position.
+    template<typename Streams>
+    inline void packInstance(InstanceDataPacked& out, const Streams& particles, int i)
+    {
+        out.pos = particles.getPosition(i);
+        out.scale = glm::packHalf1x16(particles.radius[i]);
+        std::memcpy(out.color, &particles.color[i], sizeof(out.color)); //Already UNORM8 RGBA.
+        out.angle = glm::packHalf1x16(0.0f);
+        out.pad = 0;
+    }
 }
 //--INSTANCE-DATA-PACKED-END--
 
-Instance::Instance(unsigned XSegments, unsigned YSegments, int maxInstances)
+Instance::Instance(unsigned subdivisions, int maxInstances)
 {
     capacity = maxInstances;
-    buildMesh(XSegments, YSegments); //Generate the shared unit sphere mesh once.
+    buildMesh(subdivisions); //Generate the shared sphere LOD meshes once.
 
     glGenBuffers(1, &instanceVertexBuffer);
 
@@ -41,7 +56,7 @@ Instance::Instance(unsigned XSegments, unsigned YSegments, int maxInstances)
         static_cast<GLsizeiptr>(capacity) * static_cast<GLsizeiptr>(sizeof(InstanceDataPacked)),
         nullptr, GL_STREAM_DRAW); //Ring/stream buffer for per-frame instance uploads.
 
-    setupInstanceAttribs(); //Enable per-instance attributes (divisors).
+    setupInstanceAttribs(0); //Enable per-instance attributes (divisors).
     glBindVertexArray(0);
 }
 
@@ -54,7 +69,7 @@ Instance::~Instance()
 }
 
 //--SPHERE-MESH-GENERATION--
-void Instance::buildMesh(unsigned XSegments, unsigned YSegments)
+void Instance::buildMesh(unsigned subdivisions)
 {
     struct VtxPN 
     {
@@ -62,47 +77,105 @@ void Instance::buildMesh(unsigned XSegments, unsigned YSegments)
         std::uint32_t n;          //Packed normal (snorm 10:10:10 + 2).
     };
 
-    std::vector<VtxPN> vertices;
-    std::vector<std::uint16_t> indices;
+    lodCount = static_cast<int>(std::min(subdivisions, unsigned(MAX_MESH_LODS - 1))) + 1;
 
-    vertices.reserve((XSegments + 1) * (YSegments + 1));
-    indices.reserve(XSegments * YSegments * 6);
+    //Icosahedron, faces wound counter-clockwise seen from outside.
+    const float t = 1.6180339887498948482f; //Golden ratio.
+    std::vector<glm::vec3> points = {
+        { -1, t, 0 }, { 1, t, 0 }, { -1, -t, 0 }, { 1, -t, 0 },
+        { 0, -1, t }, { 0, 1, t }, { 0, -1, -t }, { 0, 1, -t },
+        { t, 0, -1 }, { t, 0, 1 }, { -t, 0, -1 }, { -t, 0, 1 } };
+    for (glm::vec3& p : points) p = glm::normalize(p);
 
-    for (unsigned y = 0; y <= YSegments; ++y)
+    std::vector<std::uint16_t> faces = {
+        0, 11, 5,   0, 5, 1,    0, 1, 7,    0, 7, 10,   0, 10, 11,
+        1, 5, 9,    5, 11, 4,   11, 10, 2,  10, 7, 6,   7, 1, 8,
+        3, 9, 4,    3, 4, 2,    3, 2, 6,    3, 6, 8,    3, 8, 9,
+        4, 9, 5,    2, 4, 11,   6, 2, 10,   8, 6, 7,    9, 8, 1 };
+
+    //Levels coarse to fine: each splits every triangle in four, new vertices on the sphere at edge midpoints.
+    std::vector<std::vector<glm::vec3>> levelPoints{ points };
+    std::vector<std::vector<std::uint16_t>> levelFaces{ faces };
+
+    for (int level = 1; level < lodCount; ++level)
     {
-        for (unsigned x = 0; x <= XSegments; ++x)
+        std::unordered_map<std::uint32_t, std::uint16_t> midpoints; //Edge (lower, higher index) to its new vertex.
+        auto midpoint = [&](std::uint16_t a, std::uint16_t b)
         {
-            float xs = float(x) / float(XSegments);
-            float ys = float(y) / float(YSegments);
-            float phi = xs * 6.2831853071795864769f;    //Azimuth.
-            float theta = ys * 3.14159265358979323846f; //Polar.
+            const std::uint32_t key = (std::uint32_t(std::min(a, b)) << 16) | std::max(a, b);
+            auto it = midpoints.find(key);
+            if (it != midpoints.end()) return it->second;
 
-            float px = std::cos(phi) * std::sin(theta);
-            float py = std::cos(theta);
-            float pz = std::sin(phi) * std::sin(theta);
+            points.push_back(glm::normalize(points[a] + points[b]));
+            const std::uint16_t m = static_cast<std::uint16_t>(points.size() - 1);
+            midpoints.emplace(key, m);
+            return m;
+        };
 
-            glm::vec4 n(px, py, pz, 0.0f);
-            std::uint32_t nPacked = glm::packSnorm3x10_1x2(n); //Pack normal for compact VBO.
+        std::vector<std::uint16_t> finer;
+        finer.reserve(faces.size() * 4);
 
-            vertices.push_back({ px, py, pz, nPacked });
+        for (size_t f = 0; f < faces.size(); f += 3)
+        {
+            const std::uint16_t a = faces[f], b = faces[f + 1], c = faces[f + 2];
+            const std::uint16_t ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+
+            const std::uint16_t split[12] = { a, ab, ca,  b, bc, ab,  c, ca, bc,  ab, bc, ca };
+            finer.insert(finer.end(), split, split + 12);
         }
+
+        faces = std::move(finer);
+        levelPoints.push_back(points);
+        levelFaces.push_back(faces);
     }
 
-    for (unsigned y = 0; y < YSegments; ++y)
+    //LOD l is level lodCount - 1 - l. Each is appended with its indices rebased, so one draw needs only an
+    //index offset.
+    std::vector<VtxPN> vertices;
+    std::vector<std::uint16_t> indices;
+
+    for (int l = 0; l < lodCount; ++l)
     {
-        for (unsigned x = 0; x < XSegments; ++x)
+        const std::vector<glm::vec3>& lp = levelPoints[lodCount - 1 - l];
+        const std::vector<std::uint16_t>& lf = levelFaces[lodCount - 1 - l];
+        const std::uint16_t base = static_cast<std::uint16_t>(vertices.size());
+
+        for (const glm::vec3& p : lp)
+        {
+            std::uint32_t nPacked = glm::packSnorm3x10_1x2(glm::vec4(p, 0.0f)); //Unit sphere: the normal is the position.
+            vertices.push_back({ p.x, p.y, p.z, nPacked });
+        }
+
+        LodMesh& mesh = lods[l];
+        mesh.firstIndex = static_cast<GLsizei>(indices.size());
+        mesh.indexCount = static_cast<GLsizei>(lf.size());
+        mesh.sagitta = 0.0f;
+
+        for (size_t f = 0; f < lf.size(); f += 3)
         {
-            std::uint16_t i0 = static_cast<std::uint16_t>(y * (XSegments + 1) + x);
-            std::uint16_t i1 = static_cast<std::uint16_t>((y + 1) * (XSegments + 1) + x);
-            std::uint16_t i2 = static_cast<std::uint16_t>((y + 1) * (XSegments + 1) + x + 1);
-            std::uint16_t i3 = static_cast<std::uint16_t>(y * (XSegments + 1) + x + 1);
+            //Faces are acute, so the point nearest the centre is the foot of the plane's normal.
+            const glm::vec3& a = lp[lf[f]];
+            const glm::vec3 n = glm::normalize(glm::cross(lp[lf[f + 1]] - a, lp[lf[f + 2]] - a));
+            mesh.sagitta = std::max(mesh.sagitta, 1.0f - glm::dot(n, a));
 
-            indices.push_back(i0); indices.push_back(i1); indices.push_back(i2);
-            indices.push_back(i0); indices.push_back(i2); indices.push_back(i3);
+            for (int k = 0; k < 3; ++k) indices.push_back(static_cast<std::uint16_t>(base + lf[f + k]));
         }
     }
 
-    indexCount = static_cast<GLsizei>(indices.size());
+    //Impostor quad, counter-clockwise as the eye sees it. The normal is unused: the fragment shader ray-casts its own.
+    {
+        const std::uint16_t base = static_cast<std::uint16_t>(vertices.size());
+        const std::uint32_t nPacked = glm::packSnorm3x10_1x2(glm::vec4(0.0f, 0.0f, 1.0f, 0.0f));
+        vertices.push_back({ -1.0f, -1.0f, 0.0f, nPacked });
+        vertices.push_back({  1.0f, -1.0f, 0.0f, nPacked });
+        vertices.push_back({  1.0f,  1.0f, 0.0f, nPacked });
+        vertices.push_back({ -1.0f,  1.0f, 0.0f, nPacked });
+
+        impostorQuad.firstIndex = static_cast<GLsizei>(indices.size());
+        impostorQuad.indexCount = 6;
+        const std::uint16_t quad[6] = { 0, 1, 2,  0, 2, 3 };
+        for (std::uint16_t k : quad) indices.push_back(static_cast<std::uint16_t>(base + k));
+    }
 
     glGenVertexArrays(1, &vertexArray);
     glGenBuffers(1, &vertexBuffer);
@@ -126,34 +199,34 @@ void Instance::buildMesh(unsigned XSegments, unsigned YSegments)
 }
 //--SPHERE-MESH-GENERATION-END--
 
-void Instance::setupInstanceAttribs()
+//GL 3.3 has no base instance, so a range starts where its attributes point: the offset is baked into them.
+void Instance::setupInstanceAttribs(int firstInstance) const
 {
     glBindVertexArray(vertexArray);
     glBindBuffer(GL_ARRAY_BUFFER, instanceVertexBuffer);
 
     const GLsizei stride = static_cast<GLsizei>(sizeof(InstanceDataPacked));
+    const std::uintptr_t base = static_cast<std::uintptr_t>(firstInstance) * sizeof(InstanceDataPacked);
 
     glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(InstanceDataPacked, pos));   //Instance position
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (const void*)(base + offsetof(InstanceDataPacked, pos)));   //Instance position
     glVertexAttribDivisor(2, 1);
 
     glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 1, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(InstanceDataPacked, scale)); //Instance scale
+    glVertexAttribPointer(3, 1, GL_HALF_FLOAT, GL_FALSE, stride, (const void*)(base + offsetof(InstanceDataPacked, scale))); //Instance scale
     glVertexAttribDivisor(3, 1);
 
     glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offsetof(InstanceDataPacked, color)); //Instance color
+    glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (const void*)(base + offsetof(InstanceDataPacked, color))); //Instance color
     glVertexAttribDivisor(4, 1);
 
     glEnableVertexAttribArray(5);
-    glVertexAttribPointer(5, 1, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(InstanceDataPacked, angle)); //Instance angle (unused)
+    glVertexAttribPointer(5, 1, GL_HALF_FLOAT, GL_FALSE, stride, (const void*)(base + offsetof(InstanceDataPacked, angle))); //Instance angle (unused)
     glVertexAttribDivisor(5, 1);
-
-    glBindVertexArray(0);
 }
 
 //--INSTANCE-BUFFER-UPDATE--
-void Instance::updateInstances(const std::vector<Sphere>& spheres, int count, float timeSeconds)
+void Instance::updateInstances(const ParticleStore& particles, int count, float timeSeconds)
 {
     const GLsizeiptr byteSize = static_cast<GLsizeiptr>(count) * static_cast<GLsizeiptr>(sizeof(InstanceDataPacked));
     glBindBuffer(GL_ARRAY_BUFFER, instanceVertexBuffer);
@@ -167,19 +240,7 @@ void Instance::updateInstances(const std::vector<Sphere>& spheres, int count, fl
     {
         for (int i = 0; i < count; ++i)
         {
-            const glm::vec3 p = spheres[i].getPosition();
-            const float s = spheres[i].getScale();
-            const glm::vec3 c = spheres[i].getColor();
-
-            dst[i].pos = p;
-            dst[i].scale = glm::packHalf1x16(s);
-
-            dst[i].color[0] = static_cast<std::uint8_t>(glm::clamp(c.r, 0.0f, 1.0f) * 255.0f + 0.5f);
-            dst[i].color[1] = static_cast<std::uint8_t>(glm::clamp(c.g, 0.0f, 1.0f) * 255.0f + 0.5f);
-            dst[i].color[2] = static_cast<std::uint8_t>(glm::clamp(c.b, 0.0f, 1.0f) * 255.0f + 0.5f);
-            dst[i].color[3] = 255;
-
-            dst[i].angle = glm::packHalf1x16(0.0f);
+            packInstance(dst[i], particles, i);
         }
 
         glUnmapBuffer(GL_ARRAY_BUFFER);
@@ -191,21 +252,14 @@ void Instance::updateInstances(const std::vector<Sphere>& spheres, int count, fl
 
         for (int i = 0; i < count; ++i)
         {
-            scratch[i].pos = spheres[i].getPosition();
-            scratch[i].scale = glm::packHalf1x16(spheres[i].getScale());
-            const glm::vec3 c = spheres[i].getColor();
-            scratch[i].color[0] = static_cast<std::uint8_t>(glm::clamp(c.r, 0.0f, 1.0f) * 255.0f + 0.5f);
-            scratch[i].color[1] = static_cast<std::uint8_t>(glm::clamp(c.g, 0.0f, 1.0f) * 255.0f + 0.5f);
-            scratch[i].color[2] = static_cast<std::uint8_t>(glm::clamp(c.b, 0.0f, 1.0f) * 255.0f + 0.5f);
-            scratch[i].color[3] = 255;
-            scratch[i].angle = glm::packHalf1x16(0.0f);
+            packInstance(scratch[i], particles, i);
         }
 
         glBufferSubData(GL_ARRAY_BUFFER, 0, byteSize, scratch.data());
     }
 }
 
-void Instance::updateInstancesFiltered(const std::vector<Sphere>& spheres, const std::vector<int>& visible, int count, float timeSeconds)
+void Instance::updateInstancesFiltered(const RenderState& particles, const std::vector<int>& visible, int count, float timeSeconds)
 {
     const int c = std::min<int>(count, (int)visible.size());
     const GLsizeiptr byteSize = static_cast<GLsizeiptr>(c) * static_cast<GLsizeiptr>(sizeof(InstanceDataPacked));
@@ -220,19 +274,7 @@ void Instance::updateInstancesFiltered(const std::vector<Sphere>& spheres, const
     {
         for (int k = 0; k < c; ++k)
         {
-            const Sphere& s = spheres[visible[k]];
-            const glm::vec3 p = s.getPosition();
-            const float     sc = s.getScale();
-            const glm::vec3 col = s.getColor();
-
-            dst[k].pos = p;
-            dst[k].scale = glm::packHalf1x16(sc);
-            dst[k].color[0] = static_cast<std::uint8_t>(glm::clamp(col.r, 0.0f, 1.0f) * 255.0f + 0.5f);
-            dst[k].color[1] = static_cast<std::uint8_t>(glm::clamp(col.g, 0.0f, 1.0f) * 255.0f + 0.5f);
-            dst[k].color[2] = static_cast<std::uint8_t>(glm::clamp(col.b, 0.0f, 1.0f) * 255.0f + 0.5f);
-            dst[k].color[3] = 255;
-
-            dst[k].angle = glm::packHalf1x16(0.0f);
+            packInstance(dst[k], particles, visible[k]);
         }
 
         glUnmapBuffer(GL_ARRAY_BUFFER);
@@ -243,15 +285,7 @@ void Instance::updateInstancesFiltered(const std::vector<Sphere>& spheres, const
 
         for (int k = 0; k < c; ++k)
         {
-            const Sphere& s = spheres[visible[k]];
-            scratch[k].pos = s.getPosition();
-            scratch[k].scale = glm::packHalf1x16(s.getScale());
-            const glm::vec3 col = s.getColor();
-            scratch[k].color[0] = static_cast<std::uint8_t>(glm::clamp(col.r, 0.0f, 1.0f) * 255.0f + 0.5f);
-            scratch[k].color[1] = static_cast<std::uint8_t>(glm::clamp(col.g, 0.0f, 1.0f) * 255.0f + 0.5f);
-            scratch[k].color[2] = static_cast<std::uint8_t>(glm::clamp(col.b, 0.0f, 1.0f) * 255.0f + 0.5f);
-            scratch[k].color[3] = 255;
-            scratch[k].angle = glm::packHalf1x16(0.0f);
+            packInstance(scratch[k], particles, visible[k]);
         }
 
         glBufferSubData(GL_ARRAY_BUFFER, 0, byteSize, scratch.data());
@@ -262,6 +296,33 @@ void Instance::updateInstancesFiltered(const std::vector<Sphere>& spheres, const
 void Instance::draw(GLsizei count) const
 {
     glBindVertexArray(vertexArray);
-    glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_SHORT, 0, count); //One draw, many instances.
+    glDrawElementsInstanced(GL_TRIANGLES, lods[0].indexCount, GL_UNSIGNED_SHORT, 0, count); //One draw, many instances.
+    glBindVertexArray(0);
+}
+
+void Instance::draw(const LodRanges& ranges) const
+{
+    for (int l = 0; l < ranges.rangeCount && l < lodCount; ++l)
+    {
+        if (ranges.count[l] == 0) continue;
+
+        setupInstanceAttribs(ranges.first[l]); //Leaves the VAO bound.
+        glDrawElementsInstanced(GL_TRIANGLES, lods[l].indexCount, GL_UNSIGNED_SHORT,
+                                (const void*)(static_cast<std::uintptr_t>(lods[l].firstIndex) * sizeof(std::uint16_t)), ranges.count[l]);
+    }
+
+    setupInstanceAttribs(0); //Back to the whole buffer for draw(count).
+    glBindVertexArray(0);
+}
+
+void Instance::drawImpostors(const LodRanges& ranges) const
+{
+    if (ranges.rangeCount <= lodCount || ranges.count[lodCount] == 0) return;
+
+    setupInstanceAttribs(ranges.first[lodCount]);
+    glDrawElementsInstanced(GL_TRIANGLES, impostorQuad.indexCount, GL_UNSIGNED_SHORT,
+                            (const void*)(static_cast<std::uintptr_t>(impostorQuad.firstIndex) * sizeof(std::uint16_t)), ranges.count[lodCount]);
+
+    setupInstanceAttribs(0);
     glBindVertexArray(0);
 }
\ No newline at end of file
@@ -4,35 +4,56 @@
 
 #pragma once
 
+#include "LodBinning.h"
+
 #include <glad/glad.h>
 #include <glm.hpp>
 #include <vector>
 
-class Sphere;
+class ParticleStore;
+struct RenderState;
 
-//Simple helper that owns a unit-sphere mesh and a per-instance buffer, and draws instanced spheres.
+//Simple helper that owns the sphere LOD meshes and a per-instance buffer, and draws instanced spheres.
+//All LODs share one vertex and one index buffer; LOD 0 is the finest icosphere, each next one has one
+//subdivision less. The impostor quad lives there too: same instance stream, its own shader.
 class Instance
 {
 public:
-    Instance(unsigned XSegments, unsigned YSegments, int maxInstances);
+    Instance(unsigned subdivisions, int maxInstances); //Finest LOD's icosphere subdivisions, one LOD per level down to 0.
     ~Instance();
 
     Instance(const Instance&) = delete;
     Instance& operator=(const Instance&) = delete;
 
-    void updateInstances(const std::vector<Sphere>& spheres, int count, float timeSeconds); //Upload all in order.
-    void updateInstancesFiltered(const std::vector<Sphere>& spheres, const std::vector<int>& visible, int count, float timeSeconds); //Upload visible subset.
-    void draw(GLsizei count) const; //Instanced draw call.
+    void updateInstances(const ParticleStore& particles, int count, float timeSeconds); //Upload all in order.
+    void updateInstancesFiltered(const RenderState& particles, const std::vector<int>& visible, int count, float timeSeconds); //Upload visible subset of a snapshot.
+    void draw(GLsizei count) const; //Instanced draw call, finest LOD.
+    void draw(const LodRanges& ranges) const; //One instanced draw per non-empty LOD range of the uploaded list.
+    void drawImpostors(const LodRanges& ranges) const; //Quads for the range past the LODs, if any (impostor shader bound).
+
+    int getLodCount() const { return lodCount; }
+    GLsizei getLodTriangles(int lod) const { return lods[lod].indexCount / 3; }
+    float getLodMaxRadius(int lod, float errorPx) const { return errorPx / lods[lod].sagitta; } //Projected radius (px) up to which its silhouette stays within errorPx.
+    GLsizei getImpostorTriangles() const { return impostorQuad.indexCount / 3; }
 
 private:
-    void buildMesh(unsigned XSegments, unsigned YSegments); //Build UV-sphere vertex/index buffers.
-    void setupInstanceAttribs(); //Enable per-instance attributes.
+    struct LodMesh
+    {
+        GLsizei firstIndex = 0;
+        GLsizei indexCount = 0;
+        float sagitta = 1.0f;       //Deepest a face sinks below the unit sphere.
+    };
+
+    void buildMesh(unsigned subdivisions); //Build the icosphere LODs and the impostor quad into the shared vertex/index buffers.
+    void setupInstanceAttribs(int firstInstance) const; //Bind the VAO and point the per-instance attributes at one range.
 
     GLuint vertexArray{ 0 };
     GLuint vertexBuffer{ 0 };
     GLuint elementBuffer{ 0 };
     GLuint instanceVertexBuffer{ 0 };
 
-    GLsizei indexCount{ 0 };
+    LodMesh lods[MAX_MESH_LODS];
+    LodMesh impostorQuad;           //Corners at (+-1, +-1, 0), the vertex shader turns it to face the eye.
+    int lodCount{ 0 };
     int capacity{ 0 };
 };
\ No newline at end of file
@@ -0,0 +1,108 @@
+/*
+    Chase-Lev work-stealing deque header: fixed-capacity ring of inline jobs, owner push/pop, thief steal.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+//One parallelFor in flight: the callable is erased to a function pointer plus context, and lives on the
+//caller's stack until `remaining` reaches zero. Nobody touches it after their decrement.
+struct ParallelTask
+{
+    void (*invoke)(void* context, int i0, int i1, int k);
+    void* context;
+    int begin, total, chunks;
+    std::atomic<int> remaining;
+    const char* label;              //Profiler scope that issued the call.
+    std::uint32_t group;            //Profiler call id.
+};
+
+//A job is one chunk of one task, stored inline: no allocation per chunk.
+struct Job
+{
+    ParallelTask* task = nullptr;
+    int chunk = 0;
+};
+
+//Lock-free deque after Chase & Lev (2005) with the C11 orderings of Le et al. (2013). The owner pushes and pops
+//at the bottom (LIFO, cache-warm), thieves take from the top (FIFO, the oldest and usually largest work).
+//The ring does not grow: push reports full and the caller runs the chunk itself.
+class JobDeque
+{
+public:
+    static constexpr std::int64_t CAPACITY = 1024; //Chunks in flight per thread (nested calls included).
+
+    bool push(const Job& job) //Owner only.
+    {
+        const std::int64_t b = bottom.load(std::memory_order_relaxed);
+        const std::int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= CAPACITY) return false;
+
+        Slot& slot = slots[b & (CAPACITY - 1)];
+        slot.task.store(job.task, std::memory_order_relaxed);
+        slot.chunk.store(job.chunk, std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(Job& job) //Owner only.
+    {
+        const std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b)
+        {
+            bottom.store(b + 1, std::memory_order_relaxed); //Was empty.
+            return false;
+        }
+
+        read(b, job);
+        if (t < b) return true; //More than one left, no thief can reach this slot.
+
+        //Last job: race the thieves for it through top.
+        const bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+
+    bool steal(Job& job) //Any thread.
+    {
+        std::int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const std::int64_t b = bottom.load(std::memory_order_acquire);
+
+        if (t >= b) return false;
+
+        read(t, job);
+        return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed); //Lost to the owner or another thief otherwise.
+    }
+
+    bool maybeNonEmpty() const
+    {
+        return bottom.load(std::memory_order_seq_cst) > top.load(std::memory_order_seq_cst);
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<ParallelTask*> task{ nullptr }; //Atomic so a thief reading a slot the owner reuses is a lost CAS, not a race.
+        std::atomic<int> chunk{ 0 };
+    };
+
+    void read(std::int64_t index, Job& job) const
+    {
+        const Slot& slot = slots[index & (CAPACITY - 1)];
+        job.task = slot.task.load(std::memory_order_relaxed);
+        job.chunk = slot.chunk.load(std::memory_order_relaxed);
+    }
+
+    alignas(64) std::atomic<std::int64_t> top{ 0 };     //Thieves' end.
+    alignas(64) std::atomic<std::int64_t> bottom{ 0 };  //Owner's end.
+    alignas(64) Slot slots[CAPACITY];
+};
@@ -0,0 +1,293 @@
+/*
+    Linear BVH implementation: Morton keys, radix sort, Karras topology, refit, Morton-prefix coloring.
+*/
+
+#include "LinearBvh.h"
+#include "RadixSort.h"
+#include "Morton.h"
+#include "../scene/ParticleStore.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+
+int LinearBvh::commonPrefix(int i, int j) const
+{
+    if (j < 0 || j >= leafCount) return -1;
+
+    const std::uint32_t a = codes[i], b = codes[j];
+    if (a == b) return 32 + std::countl_zero(static_cast<std::uint32_t>(i ^ j)); //Equal keys: the leaf index breaks the tie.
+
+    return std::countl_zero(a ^ b);
+}
+
+void LinearBvh::build(ThreadSystem& tasks, const ParticleStore& particles)
+{
+    if (particles.size() != leafCount || leafCount < 2 || refits >= refitLimit)
+    {
+        rebuild(tasks, particles);
+        return;
+    }
+
+    //--REFIT-- (same topology and color runs, only valid while no sphere left the slack of its cell)
+    if (refreshLeaves(tasks, particles) > driftLimit)
+    {
+        rebuild(tasks, particles);
+        return;
+    }
+
+    propagateBounds(tasks);
+    ++refits;
+    lastWasRefit = true;
+    //--REFIT-END--
+}
+
+void LinearBvh::rebuild(ThreadSystem& tasks, const ParticleStore& particles)
+{
+    const int count = particles.size();
+    const int chunkSlots = tasks.getThreadCount();
+    const int MIN_GRAIN = 4096;
+
+    leafCount = count;
+    refits = 0;
+    lastWasRefit = false;
+
+    nodes.resize(count > 0 ? 2 * count - 1 : 0);
+    leafIds.resize(count);
+    builtCenters.resize(count);
+    arrivals.resize(count > 0 ? count - 1 : 0);
+
+    //--CENTER-BOUNDS-- (per-chunk reduction, the tree adapts to wherever the spheres are)
+    chunkMin.assign(chunkSlots, glm::vec3(INFINITY));
+    chunkMax.assign(chunkSlots, glm::vec3(-INFINITY));
+    chunkRadius.assign(chunkSlots, 0.0f);
+
+    tasks.parallelFor(0, count, MIN_GRAIN, [&](int i0, int i1, int k)
+    {
+        glm::vec3 lo(INFINITY), hi(-INFINITY);
+        float maxRadius = 0.0f;
+
+        for (int i = i0; i < i1; ++i)
+        {
+            const glm::vec3 p = particles.getPosition(i);
+            lo = glm::min(lo, p);
+            hi = glm::max(hi, p);
+            maxRadius = std::max(maxRadius, particles.radius[i]);
+        }
+
+        chunkMin[k] = lo;
+        chunkMax[k] = hi;
+        chunkRadius[k] = maxRadius;
+    });
+
+    glm::vec3 origin(0.0f), extent(0.0f);
+    float maxRadius = 0.0f;
+
+    if (count > 0)
+    {
+        glm::vec3 hi(-INFINITY);
+        origin = glm::vec3(INFINITY);
+
+        for (int k = 0; k < chunkSlots; ++k)
+        {
+            origin = glm::min(origin, chunkMin[k]);
+            hi = glm::max(hi, chunkMax[k]);
+            maxRadius = std::max(maxRadius, chunkRadius[k]);
+        }
+
+        extent = hi - origin;
+    }
+    //--CENTER-BOUNDS-END--
+
+    //--COLOR-CELL-SIZE-- (longest prefix whose cube cell still holds a diameter plus the drift slack)
+    const float side = std::max({ extent.x, extent.y, extent.z, 1e-6f }) * 1.0001f; //Cube, so cells are cubes.
+    const float diameter = 2.0f * maxRadius + margin;
+    const float needed = diameter * (1.0f + 2.0f * driftSlack);
+
+    int level = 0;
+    while (level < 10 && side / float(1 << (level + 1)) >= needed) ++level;
+
+    prefixShift = 3 * (10 - level);
+    driftLimit = 0.5f * (side / float(1 << level) - diameter); //Whatever the cell has beyond one diameter, split over both spheres.
+    //--COLOR-CELL-SIZE-END--
+
+    //--MORTON-SORT--
+    const float invSide = 1024.0f / side;
+
+    codes.resize(count);
+    values.resize(count);
+
+    tasks.parallelFor(0, count, MIN_GRAIN, [&](int i0, int i1, int)
+    {
+        for (int i = i0; i < i1; ++i)
+        {
+            codes[i] = mortonOfCell(particles.getPosition(i), origin, invSide);
+            values[i] = static_cast<std::uint32_t>(i);
+        }
+    });
+
+    parallelRadixSort(tasks, codes, values, tmpKeys, tmpValues, 30); //Stable, so equal codes keep ascending ids.
+
+    tasks.parallelFor(0, count, MIN_GRAIN, [&](int i0, int i1, int)
+    {
+        for (int leaf = i0; leaf < i1; ++leaf)
+        {
+            const int id = static_cast<int>(values[leaf]);
+            Node& node = nodes[leafNode(leaf)];
+
+            leafIds[leaf] = id;
+            builtCenters[leaf] = particles.getPosition(id);
+            node.left = node.right = -1;
+            node.last = leaf;
+        }
+    });
+    //--MORTON-SORT-END--
+
+    if (count > 0) nodes[0].parent = -1; //Root (the only leaf when count == 1).
+
+    buildTopology(tasks);
+    refreshLeaves(tasks, particles);
+    propagateBounds(tasks);
+    buildRuns();
+}
+
+void LinearBvh::buildTopology(ThreadSystem& tasks)
+{
+    //--KARRAS-TOPOLOGY-- (every internal node independently: direction, range end, split)
+    tasks.parallelFor(0, leafCount - 1, 1024, [&](int i0, int i1, int)
+    {
+        for (int i = i0; i < i1; ++i)
+        {
+            const int d = (commonPrefix(i, i + 1) - commonPrefix(i, i - 1)) > 0 ? 1 : -1;
+            const int minPrefix = commonPrefix(i, i - d);
+
+            int lengthMax = 2;
+            while (commonPrefix(i, i + lengthMax * d) > minPrefix) lengthMax *= 2;
+
+            int length = 0;
+            for (int t = lengthMax / 2; t >= 1; t /= 2)
+            {
+                if (commonPrefix(i, i + (length + t) * d) > minPrefix) length += t;
+            }
+
+            const int j = i + length * d;
+            const int nodePrefix = commonPrefix(i, j);
+
+            int split = 0;
+            int t = length;
+            do
+            {
+                t = (t + 1) >> 1;
+                if (commonPrefix(i, i + (split + t) * d) > nodePrefix) split += t;
+            } while (t > 1);
+
+            const int gamma = i + split * d + std::min(d, 0);
+            const int first = std::min(i, j), last = std::max(i, j);
+
+            Node& node = nodes[i];
+            node.left = (first == gamma) ? leafNode(gamma) : gamma;
+            node.right = (last == gamma + 1) ? leafNode(gamma + 1) : gamma + 1;
+            node.last = last;
+            nodes[node.left].parent = i;  //Each child has exactly one parent, no races.
+            nodes[node.right].parent = i;
+        }
+    });
+    //--KARRAS-TOPOLOGY-END--
+}
+
+float LinearBvh::refreshLeaves(ThreadSystem& tasks, const ParticleStore& particles)
+{
+    //--LEAF-BOXES--
+    const int chunkSlots = tasks.getThreadCount();
+    const float halfMargin = 0.5f * margin;
+
+    chunkDrift.assign(chunkSlots, 0.0f);
+
+    tasks.parallelFor(0, leafCount, 4096, [&](int i0, int i1, int k)
+    {
+        float maxDrift = 0.0f;
+
+        for (int leaf = i0; leaf < i1; ++leaf)
+        {
+            const int id = leafIds[leaf];
+            const glm::vec3 p = particles.getPosition(id);
+            const float r = particles.radius[id] + halfMargin;
+            const glm::vec3 drift = glm::abs(p - builtCenters[leaf]);
+
+            Node& node = nodes[leafNode(leaf)];
+            node.lo = p - r;
+            node.hi = p + r;
+            maxDrift = std::max({ maxDrift, drift.x, drift.y, drift.z });
+        }
+
+        chunkDrift[k] = maxDrift;
+    });
+    //--LEAF-BOXES-END--
+
+    return chunkDrift.empty() ? 0.0f : *std::max_element(chunkDrift.begin(), chunkDrift.end());
+}
+
+void LinearBvh::propagateBounds(ThreadSystem& tasks)
+{
+    //--BOTTOM-UP-BOUNDS-- (min/max unions, so the result does not depend on which child arrives second)
+    std::fill(arrivals.begin(), arrivals.end(), 0);
+
+    tasks.parallelFor(0, leafCount, 4096, [&](int i0, int i1, int)
+    {
+        for (int leaf = i0; leaf < i1; ++leaf)
+        {
+            int current = nodes[leafNode(leaf)].parent;
+
+            while (current >= 0)
+            {
+                if (std::atomic_ref<int>(arrivals[current]).fetch_add(1, std::memory_order_acq_rel) == 0) break; //Sibling not done yet.
+
+                Node& node = nodes[current];
+                node.lo = glm::min(nodes[node.left].lo, nodes[node.right].lo);
+                node.hi = glm::max(nodes[node.left].hi, nodes[node.right].hi);
+                current = node.parent;
+            }
+        }
+    });
+    //--BOTTOM-UP-BOUNDS-END--
+}
+
+void LinearBvh::buildRuns()
+{
+    //--PREFIX-RUNS-- (leaves sharing a code prefix are contiguous: one run per occupied cell)
+    runStart.clear();
+    runClass.clear();
+
+    for (int leaf = 0; leaf < leafCount; ++leaf)
+    {
+        const std::uint32_t prefix = codes[leaf] >> prefixShift;
+        if (leaf > 0 && prefix == (codes[leaf - 1] >> prefixShift)) continue;
+
+        const int cellX = static_cast<int>(mortonCompactBits10(prefix));
+        const int cellY = static_cast<int>(mortonCompactBits10(prefix >> 1));
+        const int cellZ = static_cast<int>(mortonCompactBits10(prefix >> 2));
+
+        runStart.push_back(leaf);
+        runClass.push_back((cellX % 3) + 3 * (cellY % 3) + 9 * (cellZ % 3));
+    }
+
+    runStart.push_back(leafCount); //Sentinel.
+    //--PREFIX-RUNS-END--
+
+    //--RUN-COLORS--
+    const int runCount = static_cast<int>(runClass.size());
+    colorStart.assign(RUN_COLOR_COUNT + 1, 0);
+    for (int r = 0; r < runCount; ++r) ++colorStart[runClass[r] + 1];
+    for (int c = 0; c < RUN_COLOR_COUNT; ++c) colorStart[c + 1] += colorStart[c]; //Exclusive prefix sum.
+
+    colorRuns.resize(runCount);
+    std::vector<int> cursor(colorStart.begin(), colorStart.end() - 1);
+    for (int r = 0; r < runCount; ++r) colorRuns[cursor[runClass[r]]++] = r;
+    //--RUN-COLORS-END--
+}
+
+void LinearBvh::remapIds(const std::vector<int>& oldToNew)
+{
+    for (int& id : leafIds) id = oldToNew[id]; //Leaves keep their boxes, only the payload changes.
+}
@@ -0,0 +1,178 @@
+/*
+    Linear BVH header: Morton-sorted leaves, parallel Karras build, bottom-up refit, pair traversal.
+*/
+
+#pragma once
+
+#include "ThreadSystem.h"
+
+#include <glm.hpp>
+#include <vector>
+#include <cstdint>
+
+class ParticleStore;
+
+//Broadphase without a dense cell table. Leaves are spheres sorted by a 30-bit Morton code of their center,
+//normalized to the cube around the current centers, so memory and work follow the sphere count and not the
+//volume they spread over. Internal nodes come from the sorted codes in one parallel pass (Karras 2012), boxes
+//are filled bottom-up. While spheres move little the tree is only refit: same topology, new boxes.
+//Pairs are reported from the leaf with the lower sorted index, so every pair is found once.
+//
+//Colors: a Morton prefix is a cube cell, and its leaves are one contiguous run. The prefix length is chosen so a
+//cell is at least one interaction diameter plus twice the allowed drift, which keeps every partner in the 27
+//neighbour cells of the cell it was built in. Runs are split into 27 classes (x%3, y%3, z%3) like a grid.
+class LinearBvh
+{
+public:
+    float margin = 0.0f;            //Leaf boxes are widened by this so near-touching pairs are kept (speculative contacts).
+    int refitLimit = 8;             //Refits in a row before a full rebuild restores tree quality.
+    float driftSlack = 0.25f;       //Allowed drift since the last rebuild, as a fraction of the interaction diameter.
+
+    void build(ThreadSystem& tasks, const ParticleStore& particles);   //Refit if possible, otherwise rebuild.
+    void rebuild(ThreadSystem& tasks, const ParticleStore& particles); //Morton codes, radix sort, topology, boxes.
+    void remapIds(const std::vector<int>& oldToNew);                   //Keep the tree valid after a storage permutation.
+
+    bool wasRefit() const { return lastWasRefit; }
+    int getNodeCount() const { return static_cast<int>(nodes.size()); }
+
+    //--COLORED-SOURCE-- (same shape as UniformGrid's, consumed by ContactSolver::build)
+    static constexpr int RUN_COLOR_COUNT = 27;
+    int getColorCount() const { return RUN_COLOR_COUNT; }
+    bool hasColorClasses() const { return (int)colorStart.size() == RUN_COLOR_COUNT + 1; }
+    int getColorClassBegin(int color) const { return colorStart[color]; }
+    int getColorClassEnd(int color) const { return colorStart[color + 1]; }
+
+    template<typename GetPos, typename GetRad, typename Fn>
+    void forEachPotentialPairInColorCell(int idx, GetPos& /*getPos*/, GetRad& /*getRad*/, Fn& fn) const
+    {
+        const int run = colorRuns[idx];
+        for (int leaf = runStart[run]; leaf < runStart[run + 1]; ++leaf) traverseFrom(leaf, fn);
+    }
+    //--COLORED-SOURCE-END--
+
+    //Enumerate potential pairs, each once.
+    template<typename Fn>
+    void forEachPotentialPair(Fn&& fn) const
+    {
+        for (int leaf = 0; leaf < leafCount; ++leaf) traverseFrom(leaf, fn);
+    }
+
+    //Same as above, but split across the thread pool (fn must synchronize if it writes).
+    template<typename Fn>
+    void forEachPotentialPairParallel(ThreadSystem& tasks, Fn&& fn) const
+    {
+        tasks.parallelFor(0, leafCount, 256, [&](int begin, int end, int)
+        {
+            for (int leaf = begin; leaf < end; ++leaf) traverseFrom(leaf, fn);
+        });
+    }
+
+    //Interface match for UniformGrid: the traversal already tests boxes on all three axes.
+    template<typename GetPos, typename GetRad, typename Fn>
+    void forEachPotentialPairPrunedParallel(ThreadSystem& tasks, GetPos /*getPos*/, GetRad /*getRad*/, Fn&& fn) const
+    {
+        forEachPotentialPairParallel(tasks, fn);
+    }
+
+    //Lock-free variant: one color class at a time, parallel inside the class.
+    template<typename GetPos, typename GetRad, typename Fn>
+    void forEachPotentialPairColoredParallel(ThreadSystem& tasks, GetPos getPos, GetRad getRad, Fn&& fn) const
+    {
+        if (!hasColorClasses()) return;
+
+        for (int color = 0; color < RUN_COLOR_COUNT; ++color)
+        {
+            tasks.parallelFor(colorStart[color], colorStart[color + 1], 4, [&](int begin, int end, int)
+            {
+                for (int idx = begin; idx < end; ++idx) forEachPotentialPairInColorCell(idx, getPos, getRad, fn);
+            }); //parallelFor blocks, which is the barrier between classes.
+        }
+    }
+
+private:
+    struct Node
+    {
+        glm::vec3 lo, hi;           //Bounds of the subtree (leaf: center +- (radius + margin / 2)).
+        int left, right;            //Child node indices, -1 for leaves.
+        int parent;                 //-1 for the root.
+        int last;                   //Highest leaf index below this node (skip subtrees that only hold earlier leaves).
+    };
+
+    //Nodes [0, leafCount - 1) are internal (0 is the root), leaf k is node leafCount - 1 + k.
+    int leafNode(int leaf) const { return leafCount - 1 + leaf; }
+
+    //Every leaf after `leaf` whose box overlaps it. Depth is bounded by the 30 code bits plus 32 tie-break bits.
+    template<typename Fn>
+    void traverseFrom(int leaf, Fn& fn) const
+    {
+        if (leafCount < 2) return;
+
+        const Node& query = nodes[leafNode(leaf)];
+        const int idA = leafIds[leaf];
+
+        int stack[64];
+        int top = 0;
+        int current = 0;
+
+        for (;;)
+        {
+            const Node& node = nodes[current];
+
+            if (node.left < 0)
+            {
+                fn(idA, leafIds[node.last]); //Box overlap only, the narrow phase does the exact test.
+            }
+            else
+            {
+                //Test both children here so only overlapping ones are ever pushed.
+                const bool left = visits(nodes[node.left], leaf, query);
+                const bool right = visits(nodes[node.right], leaf, query);
+
+                if (left || right)
+                {
+                    current = left ? node.left : node.right;
+                    if (left && right) stack[top++] = node.right;
+                    continue;
+                }
+            }
+
+            if (top == 0) return;
+            current = stack[--top];
+        }
+    }
+
+    //Subtree holds a later leaf and its box overlaps the query (earlier leaves report the pair themselves).
+    static bool visits(const Node& node, int leaf, const Node& query)
+    {
+        return node.last > leaf &&
+               node.lo.x <= query.hi.x && node.hi.x >= query.lo.x &&
+               node.lo.y <= query.hi.y && node.hi.y >= query.lo.y &&
+               node.lo.z <= query.hi.z && node.hi.z >= query.lo.z;
+    }
+
+    int commonPrefix(int i, int j) const;                               //Karras delta: shared key bits, -1 out of range.
+    void buildTopology(ThreadSystem& tasks);                            //One internal node per pair of neighbouring keys.
+    float refreshLeaves(ThreadSystem& tasks, const ParticleStore& particles); //Leaf boxes, returns the largest drift.
+    void propagateBounds(ThreadSystem& tasks);                          //Bottom-up, the second child to arrive goes on.
+    void buildRuns();                                                   //Morton-prefix cells and their 27 classes.
+
+    std::vector<Node> nodes;
+    std::vector<int> leafIds;               //Sphere id per leaf (sorted by code).
+    std::vector<std::uint32_t> codes;       //Sorted Morton codes.
+    std::vector<std::uint32_t> values, tmpKeys, tmpValues; //Radix sort payload and scratch.
+    std::vector<glm::vec3> builtCenters;    //Center per leaf at the last rebuild (drift check).
+    std::vector<int> arrivals;              //Per internal node: children finished in propagateBounds.
+    std::vector<glm::vec3> chunkMin, chunkMax; //Per-chunk reduction scratch.
+    std::vector<float> chunkDrift, chunkRadius;
+
+    std::vector<int> runStart;              //Run r owns leaves [runStart[r], runStart[r + 1]).
+    std::vector<int> runClass;              //Color class per run.
+    std::vector<int> colorRuns;             //Runs grouped by class.
+    std::vector<int> colorStart;            //Color c owns colorRuns[colorStart[c], colorStart[c + 1]).
+
+    int leafCount = 0;
+    int prefixShift = 30;                   //code >> prefixShift is the color cell.
+    float driftLimit = 0.0f;                //Largest drift a refit accepts.
+    int refits = 0;
+    bool lastWasRefit = false;
+};
@@ -0,0 +1,71 @@
+/*
+    LOD binning implementation: per-sphere bin pick with per-chunk histograms, then one stable scatter.
+*/
+
+#include "LodBinning.h"
+
+#include <algorithm>
+
+void LodBinner::bin(ThreadSystem& tasks, const CullStreams& spheres, const int* visible, int count, const glm::vec3& eye,
+                    float pixelsPerUnit, const float* maxRadiusPx, int binCount, int* out, LodRanges& ranges)
+{
+    ranges.rangeCount = std::clamp(binCount, 1, MAX_LOD_BINS);
+    binCount = ranges.rangeCount;
+
+    //R <= limit  <=>  r * r * ppu * ppu <= limit * limit * |c - eye|^2.
+    float limit2[MAX_LOD_BINS];
+    for (int l = 0; l < binCount; ++l) limit2[l] = maxRadiusPx[l] * maxRadiusPx[l];
+    const float ppu2 = pixelsPerUnit * pixelsPerUnit;
+
+    binOf.resize((size_t)std::max(count, 1));
+
+    const int slots = tasks.getThreadCount();
+    if ((int)chunks.size() < slots) chunks.resize(slots);
+    for (Chunk& c : chunks) c = Chunk{};
+
+    //--LOD-PICK-- (bin per sphere, counted per chunk)
+    tasks.parallelFor(0, count, 4096, [&](int j0, int j1, int k)
+    {
+        Chunk& c = chunks[k];
+        c.begin = j0; c.end = j1;
+
+        for (int j = j0; j < j1; ++j)
+        {
+            const int i = visible[j];
+            const glm::vec3 d = cullCenter(spheres, i) - eye;
+            const float r = spheres.r[i];
+            const float size2 = r * r * ppu2;
+            const float dist2 = glm::dot(d, d);
+
+            int l = binCount - 1;
+            while (l > 0 && size2 > limit2[l] * dist2) --l; //Last bin first, earlier ones while too big for it.
+            binOf[j] = static_cast<std::uint8_t>(l);
+            ++c.offset[l];
+        }
+    });
+    //--LOD-PICK-END--
+
+    //--LOD-RANGES-- (prefix over bin, then chunk: chunk k's range precedes chunk k + 1's, so the scatter is stable)
+    int total = 0;
+    for (int l = 0; l < binCount; ++l)
+    {
+        ranges.first[l] = total;
+        for (int k = 0; k < slots; ++k)
+        {
+            const int n = chunks[k].offset[l];
+            chunks[k].offset[l] = total;
+            total += n;
+        }
+        ranges.count[l] = total - ranges.first[l];
+    }
+
+    tasks.parallelFor(0, slots, 1, [&](int k0, int k1, int)
+    {
+        for (int k = k0; k < k1; ++k)
+        {
+            Chunk& c = chunks[k];
+            for (int j = c.begin; j < c.end; ++j) out[c.offset[binOf[j]]++] = visible[j];
+        }
+    });
+    //--LOD-RANGES-END--
+}
@@ -0,0 +1,46 @@
+/*
+    LOD binning header: splits the visible list into per-mesh-LOD instance ranges by projected sphere size.
+*/
+
+#pragma once
+
+#include "SimdCulling.h"
+#include "ThreadSystem.h"
+
+#include <glm.hpp>
+#include <cstdint>
+#include <vector>
+
+static constexpr int MAX_MESH_LODS = 6; //Icosphere subdivisions 0-5 still fit 16-bit indices in one buffer.
+static constexpr int MAX_LOD_BINS = MAX_MESH_LODS + 1; //Mesh LODs, then the impostor range.
+
+//Where each bin's instances sit in the binned list. Bin 0 is the finest mesh and comes first: near, large
+//spheres are drawn before the far ones they cover. Past the mesh LODs comes the impostor bin, if binned.
+struct LodRanges
+{
+    int rangeCount = 0;
+    int first[MAX_LOD_BINS] = {};
+    int count[MAX_LOD_BINS] = {};
+};
+
+//A sphere of projected radius R pixels gets the last bin l with R <= maxRadiusPx[l], bin 0 if none (its entry
+//is ignored). The limits need not be ordered: an impostor limit above a coarse LOD's simply empties that LOD.
+//Radii are compared squared against the eye distance, so there is no sqrt per sphere.
+class LodBinner
+{
+public:
+    //Writes the ids of visible[0, count) to out grouped by bin, ascending within each range (out must not
+    //alias visible).
+    void bin(ThreadSystem& tasks, const CullStreams& spheres, const int* visible, int count, const glm::vec3& eye,
+             float pixelsPerUnit, const float* maxRadiusPx, int binCount, int* out, LodRanges& ranges);
+
+private:
+    struct Chunk
+    {
+        int begin = 0, end = 0;             //Empty for chunk slots the call did not use.
+        int offset[MAX_LOD_BINS] = {};      //Pass one: spheres per bin. Pass two: where the next one goes.
+    };
+
+    std::vector<std::uint8_t> binOf;    //Per visible slot.
+    std::vector<Chunk> chunks;          //One slot per possible chunk (getThreadCount()).
+};
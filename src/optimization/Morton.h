@@ -0,0 +1,45 @@
+/*
+    Morton helpers: 10-bit-per-axis Z-order codes for cell coordinates and normalized positions.
+*/
+
+#pragma once
+
+#include <glm.hpp>
+#include <cstdint>
+
+//--MORTON-CODES--
+//Spread the low 10 bits of v so there are two zero bits between each (bit i -> bit 3i).
+inline std::uint32_t mortonExpandBits10(std::uint32_t v)
+{
+    v &= 0x3FFu;
+    v = (v | (v << 16)) & 0x030000FFu;
+    v = (v | (v << 8)) & 0x0300F00Fu;
+    v = (v | (v << 4)) & 0x030C30C3u;
+    v = (v | (v << 2)) & 0x09249249u;
+    return v;
+}
+
+//Inverse of mortonExpandBits10: gather every third bit back into the low 10 bits.
+inline std::uint32_t mortonCompactBits10(std::uint32_t v)
+{
+    v &= 0x09249249u;
+    v = (v | (v >> 2)) & 0x030C30C3u;
+    v = (v | (v >> 4)) & 0x0300F00Fu;
+    v = (v | (v >> 8)) & 0x030000FFu;
+    v = (v | (v >> 16)) & 0x3FFu;
+    return v;
+}
+
+//30-bit Z-order code, x in the lowest interleaved bit.
+inline std::uint32_t morton3D(std::uint32_t x, std::uint32_t y, std::uint32_t z)
+{
+    return mortonExpandBits10(x) | (mortonExpandBits10(y) << 1) | (mortonExpandBits10(z) << 2);
+}
+
+//Morton code of the grid cell that contains p (cells of size 1 / invCellSize starting at origin, clamped to 0..1023).
+inline std::uint32_t mortonOfCell(const glm::vec3& p, const glm::vec3& origin, float invCellSize)
+{
+    const glm::vec3 c = glm::clamp((p - origin) * invCellSize, glm::vec3(0.0f), glm::vec3(1023.0f));
+    return morton3D(static_cast<std::uint32_t>(c.x), static_cast<std::uint32_t>(c.y), static_cast<std::uint32_t>(c.z));
+}
+//--MORTON-CODES-END--
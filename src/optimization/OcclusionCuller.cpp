@@ -0,0 +1,307 @@
+/*
+    Occlusion culler implementation: occluder pick, binned tile raster (scalar/AVX2 spans), Hi-Z build and sphere test.
+*/
+
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    const float FAR_DEPTH = std::numeric_limits<float>::infinity(); //Cleared texel: hides nothing.
+    const float NEAR_W = 1e-3f;         //Spheres reaching closer than this to the eye plane get no screen rect.
+    const float SLACK = 0.01f;          //Texels: rects grow and spans shrink by this, so rounding never errs toward hiding.
+
+    //Texels of row y wholly inside the ellipse, [x0, x1). The row edge farther from the centre bounds the width.
+    template<typename Ellipse>
+    inline bool innerSpan(const Ellipse& e, int y, int width, int& x0, int& x1)
+    {
+        const float dy = std::max(std::abs((float)y - e.cy), std::abs((float)(y + 1) - e.cy));
+        if (dy >= e.ry) return false;
+
+        const float t = dy / e.ry;
+        const float half = e.rx * std::sqrt(1.0f - t * t) - SLACK;
+        x0 = std::max(0, (int)std::ceil(e.cx - half));
+        x1 = std::min(width, (int)std::floor(e.cx + half));
+        return x1 > x0;
+    }
+
+    //--SPAN-KERNELS--
+    inline void spanMinScalar(float* row, int count, float depth)
+    {
+        for (int k = 0; k < count; ++k) row[k] = std::min(row[k], depth);
+    }
+
+#if SIMD_X86
+    SIMD_TARGET_AVX2 int spanMinAVX2(float* row, int count, float depth)
+    {
+        const int vecEnd = count & ~7;
+        const __m256 d = _mm256_set1_ps(depth);
+
+        for (int k = 0; k < vecEnd; k += 8) //8 texels per iteration.
+        {
+            _mm256_storeu_ps(row + k, _mm256_min_ps(_mm256_loadu_ps(row + k), d));
+        }
+
+        return vecEnd;
+    }
+#endif
+
+    inline void spanMin(float* row, int count, float depth, SimdLevel level)
+    {
+        int tail = 0;
+
+#if SIMD_X86
+        if (level >= SimdLevel::AVX2) tail = spanMinAVX2(row, count, depth);
+#else
+        (void)level;
+#endif
+
+        spanMinScalar(row + tail, count - tail, depth);
+    }
+    //--SPAN-KERNELS-END--
+}
+
+int OcclusionCuller::cull(ThreadSystem& tasks, const CullStreams& spheres, const int* visible, int count, const glm::mat4& viewProj,
+                          const glm::vec3& eyePos, int viewportW, int viewportH, int* out, SimdLevel level)
+{
+    //--VIEW-SETUP--
+    rowX = glm::vec4(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+    rowY = glm::vec4(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+    rowW = glm::vec4(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+    scaleX = glm::length(glm::vec3(rowX));
+    scaleY = glm::length(glm::vec3(rowY));
+    scaleW = glm::length(glm::vec3(rowW));
+    eye = eyePos;
+
+    width = DEPTH_WIDTH;
+    height = std::max(1, (int)std::lround(double(DEPTH_WIDTH) * viewportH / std::max(1, viewportW)));
+
+    if (levels.empty() || levels[0].w != width || levels[0].h != height) //Pyramid down to 1 x 1, kept until the size changes.
+    {
+        levels.clear();
+        int w = width, h = height;
+
+        while (true)
+        {
+            Level level;
+            level.w = w; level.h = h;
+            level.depth.resize((size_t)w * h);
+            levels.push_back(std::move(level));
+
+            if (w == 1 && h == 1) break;
+            w = (w + 1) / 2; h = (h + 1) / 2;
+        }
+    }
+    //--VIEW-SETUP-END--
+
+    occludedCount = 0;
+    selectOccluders(tasks, spheres, visible, count);
+
+    if (occluders.empty()) //Nothing big enough in front: everything stays.
+    {
+        std::copy(visible, visible + count, out);
+        return count;
+    }
+
+    rasterize(tasks, level);
+    buildHiZ(tasks);
+
+    auto notHidden = [&](int j)
+    {
+        const int i = visible[j];
+        return !isOccluded(cullCenter(spheres, i), spheres.r[i]);
+    };
+
+    const int kept = parallelCompact(tasks, testScratch, count, 1024, notHidden, out); //Slots into visible, ascending.
+
+    tasks.parallelFor(0, kept, 8192, [&](int k0, int k1, int)
+    {
+        for (int k = k0; k < k1; ++k) out[k] = visible[out[k]]; //Slots to ids: reads visible only, so no aliasing.
+    });
+
+    occludedCount = count - kept;
+    return kept;
+}
+
+//--OCCLUDER-SELECTION--
+void OcclusionCuller::selectOccluders(ThreadSystem& tasks, const CullStreams& spheres, const int* visible, int count)
+{
+    //Inner radius in texels is k * r / D. Squared on both sides: no sqrt for the spheres that do not qualify.
+    const float k = std::min(scaleX * 0.5f * width, scaleY * 0.5f * height);
+    const float k2 = k * k;
+    const float min2 = MIN_OCCLUDER_TEXELS * MIN_OCCLUDER_TEXELS;
+
+    auto qualifies = [&](int j)
+    {
+        const int i = visible[j];
+        const glm::vec3 c = cullCenter(spheres, i);
+        const float r = spheres.r[i];
+        if (glm::dot(rowW, glm::vec4(c, 1.0f)) - scaleW * r <= NEAR_W) return false; //Must lie wholly in front.
+
+        const glm::vec3 d = c - eye;
+        return k2 * r * r >= min2 * glm::dot(d, d);
+    };
+
+    candidates.resize((size_t)std::max(count, 1));
+    const int n = parallelCompact(tasks, occluderScratch, count, 1024, qualifies, candidates.data());
+    occluders.resize((size_t)n);
+
+    tasks.parallelFor(0, n, 1024, [&](int j0, int j1, int)
+    {
+        for (int j = j0; j < j1; ++j)
+        {
+            const int i = visible[candidates[j]];
+            const glm::vec3 c = cullCenter(spheres, i);
+            const glm::vec4 p(c, 1.0f);
+            const float r = spheres.r[i];
+            const float w = glm::dot(rowW, p);
+            const float distance = glm::length(c - eye);
+
+            //Rays within asin(r / D) of the centre ray hit the sphere, and a screen offset of s (clip units at w = 1)
+            //turns the ray by at most s / scale: r / D per axis is inside. Where such a ray enters, the normal faces
+            //the eye, at least 90 degrees from the centre ray; with the view axis phi off that ray the entry point's
+            //view depth is at most w + r sin(phi). D itself would be metres too far toward the screen edges.
+            Occluder& o = occluders[j];
+            o.cx = (glm::dot(rowX, p) / w + 1.0f) * 0.5f * width;
+            o.cy = (glm::dot(rowY, p) / w + 1.0f) * 0.5f * height;
+            o.rx = scaleX * r / distance * 0.5f * width;
+            o.ry = scaleY * r / distance * 0.5f * height;
+            const float cosPhi = std::min(1.0f, w / (scaleW * distance));
+            o.depth = w + scaleW * r * std::sqrt(1.0f - cosPhi * cosPhi);
+            o.y0 = std::max(0, (int)std::floor(o.cy - o.ry));
+            o.y1 = std::min(height, (int)std::ceil(o.cy + o.ry));
+        }
+    });
+
+    if (n > MAX_OCCLUDERS) //Keep the widest: they cover the most per raster span.
+    {
+        std::nth_element(occluders.begin(), occluders.begin() + MAX_OCCLUDERS, occluders.end(),
+                         [](const Occluder& a, const Occluder& b) { return a.rx > b.rx; });
+        occluders.resize(MAX_OCCLUDERS);
+    }
+}
+//--OCCLUDER-SELECTION-END--
+
+//--TILED-RASTER-- (occluders binned by tile; each job owns TILE_ROWS-row bands, clears them and draws its bins)
+void OcclusionCuller::rasterize(ThreadSystem& tasks, SimdLevel level)
+{
+    Level& target = levels[0];
+    const int tiles = (height + TILE_ROWS - 1) / TILE_ROWS;
+
+    //Counting sort into per-tile lists (CSR), ascending occluder index within a tile.
+    binStart.assign((size_t)tiles + 1, 0);
+    for (const Occluder& o : occluders)
+    {
+        for (int t = o.y0 / TILE_ROWS; t * TILE_ROWS < o.y1; ++t) ++binStart[t + 1];
+    }
+    for (int t = 0; t < tiles; ++t) binStart[t + 1] += binStart[t];
+
+    binItems.resize((size_t)binStart[tiles]);
+    binCursor.assign(binStart.begin(), binStart.end() - 1);
+    for (int j = 0; j < (int)occluders.size(); ++j)
+    {
+        for (int t = occluders[j].y0 / TILE_ROWS; t * TILE_ROWS < occluders[j].y1; ++t) binItems[binCursor[t]++] = j;
+    }
+
+    tasks.parallelFor(0, tiles, 1, [&](int t0, int t1, int)
+    {
+        for (int t = t0; t < t1; ++t)
+        {
+            const int rowBegin = t * TILE_ROWS;
+            const int rowEnd = std::min(height, rowBegin + TILE_ROWS);
+            std::fill(target.depth.begin() + (size_t)rowBegin * width, target.depth.begin() + (size_t)rowEnd * width, FAR_DEPTH);
+
+            for (int b = binStart[t]; b < binStart[t + 1]; ++b)
+            {
+                const Occluder& o = occluders[binItems[b]];
+                const int y0 = std::max(o.y0, rowBegin);
+                const int y1 = std::min(o.y1, rowEnd);
+
+                for (int y = y0; y < y1; ++y)
+                {
+                    int x0 = 0, x1 = 0;
+                    if (innerSpan(o, y, width, x0, x1)) spanMin(target.depth.data() + (size_t)y * width + x0, x1 - x0, o.depth, level);
+                }
+            }
+        }
+    });
+}
+//--TILED-RASTER-END--
+
+//--HI-Z-BUILD--
+void OcclusionCuller::buildHiZ(ThreadSystem& tasks)
+{
+    for (size_t l = 1; l < levels.size(); ++l)
+    {
+        const Level& src = levels[l - 1];
+        Level& dst = levels[l];
+
+        tasks.parallelFor(0, dst.h, 64, [&](int y0, int y1, int)
+        {
+            for (int y = y0; y < y1; ++y)
+            {
+                const float* rowA = src.depth.data() + (size_t)(2 * y) * src.w;
+                const float* rowB = src.depth.data() + (size_t)std::min(2 * y + 1, src.h - 1) * src.w; //Odd sizes repeat the edge.
+                float* row = dst.depth.data() + (size_t)y * dst.w;
+
+                for (int x = 0; x < dst.w; ++x)
+                {
+                    const int x0 = 2 * x;
+                    const int x1 = std::min(x0 + 1, src.w - 1);
+                    row[x] = std::max(std::max(rowA[x0], rowA[x1]), std::max(rowB[x0], rowB[x1])); //Farthest of the four.
+                }
+            }
+        });
+    }
+}
+//--HI-Z-BUILD-END--
+
+//--SPHERE-TEST--
+bool OcclusionCuller::isOccluded(const glm::vec3& c, float r) const
+{
+    if (occluders.empty()) return false;
+
+    const glm::vec4 p(c, 1.0f);
+    const float w = glm::dot(rowW, p);
+    const float nearW = w - scaleW * r;
+    if (nearW <= NEAR_W) return false;
+    const float farW = w + scaleW * r;
+
+    //Any point of the sphere has clip x within x +- scaleX * r and w within [nearW, farW]: the widest ratio
+    //takes the nearest w for a positive numerator and the farthest for a negative one.
+    const float x = glm::dot(rowX, p), y = glm::dot(rowY, p);
+    const float invNear = 1.0f / nearW, invFar = 1.0f / farW;
+    auto upper = [&](float v) { return v * (v >= 0.0f ? invNear : invFar); };
+    auto lower = [&](float v) { return v * (v <= 0.0f ? invNear : invFar); };
+
+    auto texel = [](float ndc, int size, float slack) //Clamped to [-1, size] first: truncating v + 1 then floors.
+    {
+        return (int)(std::clamp((ndc + 1.0f) * 0.5f * size + slack, -1.0f, (float)size) + 1.0f) - 1;
+    };
+
+    const int tx0 = texel(lower(x - scaleX * r), width, -SLACK);
+    const int tx1 = texel(upper(x + scaleX * r), width, SLACK);
+    const int ty0 = texel(lower(y - scaleY * r), height, -SLACK);
+    const int ty1 = texel(upper(y + scaleY * r), height, SLACK);
+    if (tx1 < 0 || ty1 < 0 || tx0 >= width || ty0 >= height) return false;
+
+    const int x0 = std::max(tx0, 0), x1 = std::min(tx1, width - 1);
+    const int y0 = std::max(ty0, 0), y1 = std::min(ty1, height - 1);
+
+    int l = 0; //Finest level where the rect spans at most 4 x 4 texels: coarser reads more empty space.
+    while (l + 1 < (int)levels.size() && ((x1 >> l) - (x0 >> l) > 3 || (y1 >> l) - (y0 >> l) > 3)) ++l;
+
+    const Level& hiZ = levels[l];
+    float farthest = 0.0f;
+    for (int ly = y0 >> l; ly <= (y1 >> l); ++ly)
+    {
+        const float* row = hiZ.depth.data() + (size_t)ly * hiZ.w;
+        for (int lx = x0 >> l; lx <= (x1 >> l); ++lx) farthest = std::max(farthest, row[lx]);
+    }
+
+    return nearW > farthest; //Behind the farthest occluder over its whole footprint.
+}
+//--SPHERE-TEST-END--
@@ -0,0 +1,77 @@
+/*
+    Occlusion culler header: CPU hierarchical depth buffer that drops frustum-visible spheres hidden behind nearer ones.
+*/
+
+#pragma once
+
+#include "SimdDispatch.h"
+#include "SimdCulling.h"
+#include "ParallelScan.h"
+
+#include <glm.hpp>
+#include <vector>
+
+//No GL anywhere: everything runs on ThreadSystem, so the same code can be checked headless.
+//1. Occluders: frustum-visible spheres whose inner ellipse covers a whole texel. Each is written as the ellipse
+//   every ray of which is sure to hit it, at a depth no nearer than any point where those rays enter: never
+//   wider or nearer than the sphere itself.
+//2. Raster: a low-res buffer of view depth (clip w), nearest occluder per texel. Occluders are binned by
+//   TILE_ROWS-row tiles, one job per tile, so threads never share a texel. Rows are filled span by span (SIMD min).
+//3. Hi-Z: each level keeps the farthest of the 4 texels below it.
+//4. Test: a sphere's nearest depth against the finest level where its conservative screen rect spans at most
+//   4 x 4 texels. Hidden only if it lies behind everything written there.
+//Spheres of a pile are small on screen and only hide each other in groups, so coverage comes from many small
+//occluders rather than a few large ones. Assumes a perspective projection whose clip w is the view depth.
+class OcclusionCuller
+{
+public:
+    static constexpr int DEPTH_WIDTH = 512;         //Texels across, the height follows the viewport aspect.
+    static constexpr int TILE_ROWS = 16;            //Rows per raster job.
+    static constexpr int MAX_OCCLUDERS = 32768;     //Largest projected spheres kept, bounds the raster cost.
+    static constexpr float MIN_OCCLUDER_TEXELS = 1.0f; //Inner radius below this covers no whole texel.
+
+    //Writes the ids of visible[0, count) that are not hidden to out, ascending (out must not alias visible).
+    //Returns how many.
+    int cull(ThreadSystem& tasks, const CullStreams& spheres, const int* visible, int count, const glm::mat4& viewProj,
+             const glm::vec3& eye, int viewportW, int viewportH, int* out, SimdLevel level);
+
+    bool isOccluded(const glm::vec3& c, float r) const; //Against the buffer the last cull() built.
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getLevelCount() const { return (int)levels.size(); }
+    float getDepth(int level, int x, int y) const { return levels[level].depth[(size_t)y * levels[level].w + x]; }
+    int getOccluderCount() const { return (int)occluders.size(); }
+    int getOccludedCount() const { return occludedCount; }
+
+private:
+    struct Occluder
+    {
+        float cx, cy;       //Centre in texels.
+        float rx, ry;       //Inner ellipse radii in texels.
+        float depth;        //Clip w no nearer than any point where a ray through the ellipse enters the sphere.
+        int y0, y1;         //Rows it may touch, [y0, y1).
+    };
+
+    struct Level
+    {
+        int w = 0, h = 0;
+        std::vector<float> depth;
+    };
+
+    void selectOccluders(ThreadSystem& tasks, const CullStreams& spheres, const int* visible, int count);
+    void rasterize(ThreadSystem& tasks, SimdLevel level);
+    void buildHiZ(ThreadSystem& tasks);
+
+    glm::vec4 rowX{ 0.0f }, rowY{ 0.0f }, rowW{ 0.0f }; //Clip x, y, w as dot products with (p, 1).
+    float scaleX = 0.0f, scaleY = 0.0f, scaleW = 0.0f; //Their largest change per unit of world distance.
+    glm::vec3 eye{ 0.0f };
+
+    int width = 0, height = 0;
+    std::vector<Level> levels;                      //levels[0] is the raster target.
+    std::vector<Occluder> occluders;
+    std::vector<int> candidates;
+    std::vector<int> binStart, binCursor, binItems; //Occluders per raster tile (CSR).
+    ParallelScratch occluderScratch, testScratch;
+    int occludedCount = 0;
+};
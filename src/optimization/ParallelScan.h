@@ -0,0 +1,175 @@
+/*
+    Parallel scan header: chunked prefix sum and stream compaction over ThreadSystem.
+*/
+
+#pragma once
+
+#include "ThreadSystem.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+//Per-call-site scratch. Each chunk of a call records its own range, so the second pass walks the ranges
+//the first pass actually saw instead of re-deriving parallelFor's split. One instance per call site: stages
+//that run at the same time (TaskGraph) must not share one. Capacity is kept between calls.
+struct ParallelScratch
+{
+    struct Chunk
+    {
+        int begin = 0, end = 0;     //Empty for chunk slots the call did not use.
+        std::int64_t sum = 0;       //Scan: chunk total. Compact: kept count.
+        std::vector<int> kept;      //Compact: survivors of this chunk, ascending.
+    };
+
+    std::vector<Chunk> chunks;      //One slot per possible chunk (getThreadCount()).
+
+    void reset(int slots)
+    {
+        if ((int)chunks.size() < slots) chunks.resize(slots);
+        for (Chunk& c : chunks) { c.begin = c.end = 0; c.sum = 0; }
+    }
+};
+
+//--PARALLEL-SCAN--
+//out[i] = value(0) + ... + value(i - 1) for i in [0, n], so out needs n + 1 slots and out[n] is the total
+//(the CSR offsets layout). value(i) runs exactly once per element, on the chunk that owns i, so it may have
+//per-element side effects. Pass one writes chunk-local running sums, pass two adds the chunk offsets.
+//Integer T: the result then does not depend on the chunking.
+template<typename T, typename ValueFn>
+T parallelScan(ThreadSystem& tasks, ParallelScratch& scratch, int n, int minGrain, ValueFn&& value, T* out)
+{
+    out[0] = T(0);
+    if (n <= 0) return T(0);
+
+    const int slots = tasks.getThreadCount();
+    scratch.reset(slots);
+
+    tasks.parallelFor(0, n, minGrain, [&](int i0, int i1, int k)
+    {
+        T running = T(0);
+
+        for (int i = i0; i < i1; ++i)
+        {
+            running += value(i);
+            out[i + 1] = running;
+        }
+
+        ParallelScratch::Chunk& c = scratch.chunks[k];
+        c.begin = i0; c.end = i1;
+        c.sum = static_cast<std::int64_t>(running);
+    });
+
+    //Chunk k's range precedes chunk k + 1's (ThreadSystem guarantee), unused slots are empty.
+    std::int64_t offset = 0;
+    for (int k = 0; k < slots; ++k)
+    {
+        const std::int64_t sum = scratch.chunks[k].sum;
+        scratch.chunks[k].sum = offset;             //Now the chunk's base.
+        offset += sum;
+    }
+
+    tasks.parallelFor(0, slots, 1, [&](int k0, int k1, int)
+    {
+        for (int k = k0; k < k1; ++k)
+        {
+            const ParallelScratch::Chunk& c = scratch.chunks[k];
+            const T base = static_cast<T>(c.sum);
+            if (base == T(0)) continue;
+
+            for (int i = c.begin; i < c.end; ++i) out[i + 1] += base;
+        }
+    });
+
+    return static_cast<T>(offset);
+}
+//--PARALLEL-SCAN-END--
+
+//--PARALLEL-COMPACT--
+//Second pass shared by the compactions: per-chunk offsets in chunk order, then the lists copied in parallel.
+inline int gatherKept(ThreadSystem& tasks, ParallelScratch& scratch, int slots, int* out)
+{
+    int offset = 0;
+    for (int k = 0; k < slots; ++k)
+    {
+        ParallelScratch::Chunk& c = scratch.chunks[k];
+        c.sum = offset;
+        offset += c.begin < c.end ? (int)c.kept.size() : 0; //Unused slots may hold a stale list.
+    }
+
+    tasks.parallelFor(0, slots, 1, [&](int k0, int k1, int)
+    {
+        for (int k = k0; k < k1; ++k)
+        {
+            const ParallelScratch::Chunk& c = scratch.chunks[k];
+            if (c.begin < c.end) std::copy(c.kept.begin(), c.kept.end(), out + c.sum);
+        }
+    });
+
+    return offset;
+}
+
+//Writes every i in [0, n) with keep(i) to out, in ascending order, and returns how many. keep(i) runs once
+//per element; each chunk collects its survivors in its own buffer, then the buffers are copied to their
+//offsets in parallel. out needs room for n.
+template<typename KeepFn>
+int parallelCompact(ThreadSystem& tasks, ParallelScratch& scratch, int n, int minGrain, KeepFn&& keep, int* out)
+{
+    if (n <= 0) return 0;
+
+    const int slots = tasks.getThreadCount();
+    scratch.reset(slots);
+
+    tasks.parallelFor(0, n, minGrain, [&](int i0, int i1, int k)
+    {
+        ParallelScratch::Chunk& c = scratch.chunks[k];
+        c.begin = i0; c.end = i1;
+        c.kept.clear();
+        c.kept.reserve(static_cast<size_t>(i1 - i0)); //Grows to the largest chunk once, then stays.
+
+        for (int i = i0; i < i1; ++i)
+        {
+            if (keep(i)) c.kept.push_back(i);
+        }
+    });
+
+    return gatherKept(tasks, scratch, slots, out);
+}
+//--PARALLEL-COMPACT-END--
+
+//--PARALLEL-COMPACT-BITS--
+//parallelCompact for keep decisions made 64 at a time: fill(w0, w1) writes words [w0, w1) of the bitmask
+//(bit i & 63 of words[i >> 6] = keep(i), bits past n clear), then the same chunk turns its set bits into ids
+//with a count-trailing-zeros loop, so an empty word costs one load. Chunks own whole words, which is what
+//lets fill write them without sharing. words needs (n + 63) / 64 slots, out room for n.
+template<typename FillFn>
+int parallelCompactBits(ThreadSystem& tasks, ParallelScratch& scratch, int n, int minGrain, FillFn&& fill, std::uint64_t* words, int* out)
+{
+    if (n <= 0) return 0;
+
+    const int slots = tasks.getThreadCount();
+    scratch.reset(slots);
+
+    const int wordCount = (n + 63) >> 6;
+    tasks.parallelFor(0, wordCount, std::max(1, minGrain >> 6), [&](int w0, int w1, int k)
+    {
+        fill(w0, w1);
+
+        ParallelScratch::Chunk& c = scratch.chunks[k];
+        c.begin = w0 << 6; c.end = std::min(n, w1 << 6);
+        c.kept.clear();
+        c.kept.reserve(static_cast<size_t>(c.end - c.begin));
+
+        for (int w = w0; w < w1; ++w)
+        {
+            for (std::uint64_t bits = words[w]; bits != 0; bits &= bits - 1) //Clear the lowest set bit each round.
+            {
+                c.kept.push_back((w << 6) + std::countr_zero(bits));
+            }
+        }
+    });
+
+    return gatherKept(tasks, scratch, slots, out);
+}
+//--PARALLEL-COMPACT-BITS-END--
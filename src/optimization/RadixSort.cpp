@@ -0,0 +1,68 @@
+/*
+    Radix sort implementation: per-chunk digit histograms, digit-major offsets, stable scatter.
+*/
+
+#include "RadixSort.h"
+
+#include <algorithm>
+#include <utility>
+
+void parallelRadixSort(ThreadSystem& tasks,
+                       std::vector<std::uint32_t>& keys, std::vector<std::uint32_t>& values,
+                       std::vector<std::uint32_t>& tmpKeys, std::vector<std::uint32_t>& tmpValues,
+                       int keyBits)
+{
+    const int count = static_cast<int>(keys.size());
+    if (count <= 1) return;
+
+    const int RADIX = 256;
+    const int MIN_GRAIN = 8192;
+    const int chunkSlots = tasks.getThreadCount(); //parallelFor never splits into more chunks than workers.
+
+    tmpKeys.resize(count);
+    tmpValues.resize(count);
+
+    std::vector<int> hist; //[chunk * RADIX + digit], rewritten into scatter offsets each pass.
+
+    for (int shift = 0; shift < keyBits; shift += 8)
+    {
+        hist.assign(chunkSlots * RADIX, 0);
+
+        //--DIGIT-HISTOGRAM--
+        tasks.parallelFor(0, count, MIN_GRAIN, [&](int i0, int i1, int k)
+        {
+            int* h = hist.data() + k * RADIX;
+            for (int i = i0; i < i1; ++i) ++h[(keys[i] >> shift) & 0xFFu];
+        });
+        //--DIGIT-HISTOGRAM-END--
+
+        //--DIGIT-MAJOR-OFFSETS-- (digit outer, chunk inner keeps the sort stable)
+        int running = 0;
+        for (int d = 0; d < RADIX; ++d)
+        {
+            for (int k = 0; k < chunkSlots; ++k)
+            {
+                const int c = hist[k * RADIX + d];
+                hist[k * RADIX + d] = running;
+                running += c;
+            }
+        }
+        //--DIGIT-MAJOR-OFFSETS-END--
+
+        //--STABLE-SCATTER-- (same split as the histogram pass, so chunk k owns row k)
+        tasks.parallelFor(0, count, MIN_GRAIN, [&](int i0, int i1, int k)
+        {
+            int* h = hist.data() + k * RADIX;
+            for (int i = i0; i < i1; ++i)
+            {
+                const int dst = h[(keys[i] >> shift) & 0xFFu]++;
+                tmpKeys[dst] = keys[i];
+                tmpValues[dst] = values[i];
+            }
+        });
+        //--STABLE-SCATTER-END--
+
+        std::swap(keys, tmpKeys);
+        std::swap(values, tmpValues);
+    }
+}
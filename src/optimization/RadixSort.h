@@ -0,0 +1,17 @@
+/*
+    Radix sort header: stable parallel LSD sort of 32-bit key/value pairs on the thread pool.
+*/
+
+#pragma once
+
+#include "ThreadSystem.h"
+
+#include <vector>
+#include <cstdint>
+
+//Sorts (keys[i], values[i]) by the low keyBits bits of the key, 8 bits per pass, stable.
+//tmpKeys/tmpValues are scratch that is kept by the caller so repeated sorts do not allocate.
+void parallelRadixSort(ThreadSystem& tasks,
+                       std::vector<std::uint32_t>& keys, std::vector<std::uint32_t>& values,
+                       std::vector<std::uint32_t>& tmpKeys, std::vector<std::uint32_t>& tmpValues,
+                       int keyBits = 32);
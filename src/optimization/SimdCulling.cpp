@@ -0,0 +1,366 @@
+/*
+    SIMD culling implementation: scalar, SSE4.1 (4-wide), AVX2 (8-wide) and AVX-512 (16-wide) kernels.
+*/
+
+#include "SimdCulling.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    //--SCALAR-KERNEL--
+    inline bool sphereVisible(const CullParams& params, float x, float y, float z, float r)
+    {
+        const float limit = -(r + FRUSTUM_EPS);
+
+        for (int k = 0; k < 6; ++k)
+        {
+            const FrustumPlane& plane = params.planes[k];
+            if (plane.n.x * x + plane.n.y * y + plane.n.z * z + plane.d < limit) return false; //Outside this plane.
+        }
+
+        const float dx = x - params.eye.x;
+        const float dy = y - params.eye.y;
+        const float dz = z - params.eye.z;
+        return r * r >= params.minRatio2 * (dx * dx + dy * dy + dz * dz);
+    }
+
+    inline void cullRangeScalar(const CullStreams& s, int begin, int end, const CullParams& params, std::uint64_t* mask)
+    {
+        const float keep = 1.0f - s.alpha;
+
+        for (int i = begin; i < end; ++i)
+        {
+            float x = s.x[i], y = s.y[i], z = s.z[i];
+            if (s.prevX)
+            {
+                x = s.prevX[i] * keep + x * s.alpha;
+                y = s.prevY[i] * keep + y * s.alpha;
+                z = s.prevZ[i] * keep + z * s.alpha;
+            }
+
+            if (sphereVisible(params, x, y, z, s.r[i])) mask[i >> 6] |= std::uint64_t(1) << (i & 63);
+        }
+    }
+
+    inline void clearWords(std::uint64_t* mask, int begin, int end)
+    {
+        for (int w = begin >> 6; w < ((end + 63) >> 6); ++w) mask[w] = 0; //Kernels only OR bits in.
+    }
+
+    inline void blockBoundsScalar(const CullStreams& s, int begin, int end, CullBlock* blocks)
+    {
+        const float big = std::numeric_limits<float>::max();
+
+        for (int i0 = begin; i0 < end; i0 += 64)
+        {
+            const int i1 = std::min(end, i0 + 64);
+            glm::vec3 lo(big), hi(-big);
+
+            for (int i = i0; i < i1; ++i)
+            {
+                const glm::vec3 r(s.r[i]);
+                const glm::vec3 c(s.x[i], s.y[i], s.z[i]);
+                lo = glm::min(lo, c - r);
+                hi = glm::max(hi, c + r);
+
+                if (s.prevX) //The blend is convex: both ends bound every alpha.
+                {
+                    const glm::vec3 p(s.prevX[i], s.prevY[i], s.prevZ[i]);
+                    lo = glm::min(lo, p - r);
+                    hi = glm::max(hi, p + r);
+                }
+            }
+
+            blocks[i0 >> 6] = CullBlock{ lo, hi };
+        }
+    }
+    //--SCALAR-KERNEL-END--
+
+#if SIMD_X86
+    //--SSE41-KERNEL--
+    SIMD_TARGET_SSE41 int cullRangeSSE41(const CullStreams& s, int begin, int end, const CullParams& params, std::uint64_t* mask)
+    {
+        const int vecEnd = begin + ((end - begin) & ~3);
+
+        const __m128 eps = _mm_set1_ps(FRUSTUM_EPS);
+        const __m128 sign = _mm_set1_ps(-0.0f);
+        const __m128 keep = _mm_set1_ps(1.0f - s.alpha);
+        const __m128 alpha = _mm_set1_ps(s.alpha);
+        const __m128 eyeX = _mm_set1_ps(params.eye.x);
+        const __m128 eyeY = _mm_set1_ps(params.eye.y);
+        const __m128 eyeZ = _mm_set1_ps(params.eye.z);
+        const __m128 minRatio2 = _mm_set1_ps(params.minRatio2);
+
+        for (int i = begin; i < vecEnd; i += 4)
+        {
+            __m128 x = _mm_loadu_ps(s.x + i), y = _mm_loadu_ps(s.y + i), z = _mm_loadu_ps(s.z + i);
+            if (s.prevX)
+            {
+                x = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(s.prevX + i), keep), _mm_mul_ps(x, alpha));
+                y = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(s.prevY + i), keep), _mm_mul_ps(y, alpha));
+                z = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(s.prevZ + i), keep), _mm_mul_ps(z, alpha));
+            }
+
+            const __m128 r = _mm_loadu_ps(s.r + i);
+            const __m128 limit = _mm_xor_ps(_mm_add_ps(r, eps), sign);
+            __m128 outside = _mm_setzero_ps();
+
+            for (int k = 0; k < 6; ++k)
+            {
+                const FrustumPlane& plane = params.planes[k];
+                __m128 dist = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.n.x), x), _mm_mul_ps(_mm_set1_ps(plane.n.y), y));
+                dist = _mm_add_ps(_mm_add_ps(dist, _mm_mul_ps(_mm_set1_ps(plane.n.z), z)), _mm_set1_ps(plane.d));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, limit));
+            }
+
+            const __m128 dx = _mm_sub_ps(x, eyeX), dy = _mm_sub_ps(y, eyeY), dz = _mm_sub_ps(z, eyeZ);
+            const __m128 dist2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            const __m128 detail = _mm_cmpge_ps(_mm_mul_ps(r, r), _mm_mul_ps(minRatio2, dist2));
+
+            const unsigned bits = (unsigned)_mm_movemask_ps(_mm_andnot_ps(outside, detail));
+            mask[i >> 6] |= std::uint64_t(bits) << (i & 63); //begin is word aligned: 4 lanes never straddle.
+        }
+
+        return vecEnd; //Caller finishes the tail with the scalar kernel.
+    }
+    //--SSE41-KERNEL-END--
+
+    //--AVX2-KERNEL--
+    SIMD_TARGET_AVX2 int cullRangeAVX2(const CullStreams& s, int begin, int end, const CullParams& params, std::uint64_t* mask)
+    {
+        const int vecEnd = begin + ((end - begin) & ~7);
+
+        __m256 nx[6], ny[6], nz[6], nd[6]; //Planes broadcast once per call.
+        for (int k = 0; k < 6; ++k)
+        {
+            nx[k] = _mm256_set1_ps(params.planes[k].n.x);
+            ny[k] = _mm256_set1_ps(params.planes[k].n.y);
+            nz[k] = _mm256_set1_ps(params.planes[k].n.z);
+            nd[k] = _mm256_set1_ps(params.planes[k].d);
+        }
+
+        const __m256 eps = _mm256_set1_ps(FRUSTUM_EPS);
+        const __m256 sign = _mm256_set1_ps(-0.0f);
+        const __m256 keep = _mm256_set1_ps(1.0f - s.alpha);
+        const __m256 alpha = _mm256_set1_ps(s.alpha);
+        const __m256 eyeX = _mm256_set1_ps(params.eye.x);
+        const __m256 eyeY = _mm256_set1_ps(params.eye.y);
+        const __m256 eyeZ = _mm256_set1_ps(params.eye.z);
+        const __m256 minRatio2 = _mm256_set1_ps(params.minRatio2);
+
+        for (int i = begin; i < vecEnd; i += 8) //8 spheres per iteration.
+        {
+            __m256 x = _mm256_loadu_ps(s.x + i), y = _mm256_loadu_ps(s.y + i), z = _mm256_loadu_ps(s.z + i);
+            if (s.prevX)
+            {
+                x = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(s.prevX + i), keep), _mm256_mul_ps(x, alpha));
+                y = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(s.prevY + i), keep), _mm256_mul_ps(y, alpha));
+                z = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(s.prevZ + i), keep), _mm256_mul_ps(z, alpha));
+            }
+
+            const __m256 r = _mm256_loadu_ps(s.r + i);
+            const __m256 limit = _mm256_xor_ps(_mm256_add_ps(r, eps), sign);
+            __m256 outside = _mm256_setzero_ps();
+
+            for (int k = 0; k < 6; ++k) //No FMA: keeps parity with scalar.
+            {
+                __m256 dist = _mm256_add_ps(_mm256_mul_ps(nx[k], x), _mm256_mul_ps(ny[k], y));
+                dist = _mm256_add_ps(_mm256_add_ps(dist, _mm256_mul_ps(nz[k], z)), nd[k]);
+                outside = _mm256_or_ps(outside, _mm256_cmp_ps(dist, limit, _CMP_LT_OQ));
+            }
+
+            const __m256 dx = _mm256_sub_ps(x, eyeX), dy = _mm256_sub_ps(y, eyeY), dz = _mm256_sub_ps(z, eyeZ);
+            const __m256 dist2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+            const __m256 detail = _mm256_cmp_ps(_mm256_mul_ps(r, r), _mm256_mul_ps(minRatio2, dist2), _CMP_GE_OQ);
+
+            const unsigned bits = (unsigned)_mm256_movemask_ps(_mm256_andnot_ps(outside, detail));
+            mask[i >> 6] |= std::uint64_t(bits) << (i & 63);
+        }
+
+        return vecEnd;
+    }
+    //--AVX2-KERNEL-END--
+
+    //--AVX2-BOUNDS-KERNEL--
+    SIMD_TARGET_AVX2 inline float reduceMin(__m256 v)
+    {
+        __m128 m = _mm_min_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+        return _mm_cvtss_f32(_mm_min_ss(m, _mm_shuffle_ps(m, m, 1)));
+    }
+
+    SIMD_TARGET_AVX2 inline float reduceMax(__m256 v)
+    {
+        __m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+        return _mm_cvtss_f32(_mm_max_ss(m, _mm_shuffle_ps(m, m, 1)));
+    }
+
+    //Full 64-sphere blocks only; returns where the partial one starts. min/max round nothing, so the result
+    //equals the scalar kernel's whatever the lane order.
+    SIMD_TARGET_AVX2 int blockBoundsAVX2(const CullStreams& s, int begin, int end, CullBlock* blocks)
+    {
+        const int vecEnd = begin + ((end - begin) & ~63);
+        const float* cur[3] = { s.x, s.y, s.z };
+        const float* prev[3] = { s.prevX, s.prevY, s.prevZ };
+
+        for (int i0 = begin; i0 < vecEnd; i0 += 64)
+        {
+            CullBlock& block = blocks[i0 >> 6];
+
+            for (int k = 0; k < 3; ++k)
+            {
+                __m256 lo = _mm256_set1_ps(std::numeric_limits<float>::max());
+                __m256 hi = _mm256_set1_ps(-std::numeric_limits<float>::max());
+
+                for (int i = i0; i < i0 + 64; i += 8)
+                {
+                    const __m256 r = _mm256_loadu_ps(s.r + i);
+                    const __m256 c = _mm256_loadu_ps(cur[k] + i);
+                    lo = _mm256_min_ps(lo, _mm256_sub_ps(c, r));
+                    hi = _mm256_max_ps(hi, _mm256_add_ps(c, r));
+
+                    if (s.prevX)
+                    {
+                        const __m256 p = _mm256_loadu_ps(prev[k] + i);
+                        lo = _mm256_min_ps(lo, _mm256_sub_ps(p, r));
+                        hi = _mm256_max_ps(hi, _mm256_add_ps(p, r));
+                    }
+                }
+
+                block.lo[k] = reduceMin(lo);
+                block.hi[k] = reduceMax(hi);
+            }
+        }
+
+        return vecEnd;
+    }
+    //--AVX2-BOUNDS-KERNEL-END--
+
+    //--AVX512-KERNEL--
+    SIMD_TARGET_AVX512 int cullRangeAVX512(const CullStreams& s, int begin, int end, const CullParams& params, std::uint64_t* mask)
+    {
+        const int vecEnd = begin + ((end - begin) & ~15);
+
+        __m512 nx[6], ny[6], nz[6], nd[6];
+        for (int k = 0; k < 6; ++k)
+        {
+            nx[k] = _mm512_set1_ps(params.planes[k].n.x);
+            ny[k] = _mm512_set1_ps(params.planes[k].n.y);
+            nz[k] = _mm512_set1_ps(params.planes[k].n.z);
+            nd[k] = _mm512_set1_ps(params.planes[k].d);
+        }
+
+        const __m512 eps = _mm512_set1_ps(FRUSTUM_EPS);
+        const __m512i sign = _mm512_set1_epi32((int)0x80000000); //Float xor needs AVX512DQ, integer xor is F.
+        const __m512 keep = _mm512_set1_ps(1.0f - s.alpha);
+        const __m512 alpha = _mm512_set1_ps(s.alpha);
+        const __m512 eyeX = _mm512_set1_ps(params.eye.x);
+        const __m512 eyeY = _mm512_set1_ps(params.eye.y);
+        const __m512 eyeZ = _mm512_set1_ps(params.eye.z);
+        const __m512 minRatio2 = _mm512_set1_ps(params.minRatio2);
+
+        for (int i = begin; i < vecEnd; i += 16) //16 spheres per iteration, compares land in mask registers.
+        {
+            __m512 x = _mm512_loadu_ps(s.x + i), y = _mm512_loadu_ps(s.y + i), z = _mm512_loadu_ps(s.z + i);
+            if (s.prevX)
+            {
+                x = _mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(s.prevX + i), keep), _mm512_mul_ps(x, alpha));
+                y = _mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(s.prevY + i), keep), _mm512_mul_ps(y, alpha));
+                z = _mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(s.prevZ + i), keep), _mm512_mul_ps(z, alpha));
+            }
+
+            const __m512 r = _mm512_loadu_ps(s.r + i);
+            const __m512 limit = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(_mm512_add_ps(r, eps)), sign));
+            __mmask16 outside = 0;
+
+            for (int k = 0; k < 6; ++k)
+            {
+                __m512 dist = _mm512_add_ps(_mm512_mul_ps(nx[k], x), _mm512_mul_ps(ny[k], y));
+                dist = _mm512_add_ps(_mm512_add_ps(dist, _mm512_mul_ps(nz[k], z)), nd[k]);
+                outside |= _mm512_cmp_ps_mask(dist, limit, _CMP_LT_OQ);
+            }
+
+            const __m512 dx = _mm512_sub_ps(x, eyeX), dy = _mm512_sub_ps(y, eyeY), dz = _mm512_sub_ps(z, eyeZ);
+            const __m512 dist2 = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy)), _mm512_mul_ps(dz, dz));
+            const __mmask16 detail = _mm512_cmp_ps_mask(_mm512_mul_ps(r, r), _mm512_mul_ps(minRatio2, dist2), _CMP_GE_OQ);
+
+            const unsigned bits = (unsigned)(detail & ~outside) & 0xFFFFu;
+            mask[i >> 6] |= std::uint64_t(bits) << (i & 63);
+        }
+
+        return vecEnd;
+    }
+    //--AVX512-KERNEL-END--
+#endif
+}
+
+void cullSpheresScalar(const CullStreams& spheres, int begin, int end, const CullParams& params, std::uint64_t* mask)
+{
+    if (end <= begin) return;
+
+    clearWords(mask, begin, end);
+    cullRangeScalar(spheres, begin, end, params, mask);
+}
+
+void cullSpheres(const CullStreams& spheres, int begin, int end, const CullParams& params, std::uint64_t* mask, SimdLevel level)
+{
+    if (end <= begin) return;
+
+    clearWords(mask, begin, end);
+    int tail = begin;
+
+#if SIMD_X86
+    if (level >= SimdLevel::AVX512)     tail = cullRangeAVX512(spheres, begin, end, params, mask);
+    else if (level >= SimdLevel::AVX2)  tail = cullRangeAVX2(spheres, begin, end, params, mask);
+    else if (level >= SimdLevel::SSE41) tail = cullRangeSSE41(spheres, begin, end, params, mask);
+#else
+    (void)level;
+#endif
+
+    cullRangeScalar(spheres, tail, end, params, mask); //Remainder (or everything on the scalar path).
+}
+
+void computeCullBlocks(const CullStreams& spheres, int begin, int end, CullBlock* blocks, SimdLevel level)
+{
+    int tail = begin;
+
+#if SIMD_X86
+    if (level >= SimdLevel::AVX2) tail = blockBoundsAVX2(spheres, begin, end, blocks);
+#else
+    (void)level;
+#endif
+
+    blockBoundsScalar(spheres, tail, end, blocks); //Partial last block (or everything on the scalar path).
+}
+
+void cullSpheresBlocked(const CullStreams& spheres, const CullBlock* blocks, int begin, int end, const CullParams& params,
+                        std::uint64_t* mask, SimdLevel level)
+{
+    if (end <= begin) return;
+
+    int run = -1; //First id of the pending run of straddling blocks: one kernel call per run.
+
+    for (int i0 = begin; i0 < end; i0 += 64)
+    {
+        const int i1 = std::min(end, i0 + 64);
+        const FrustumOverlap overlap = boxOverlapsFrustum(params.planes, blocks[i0 >> 6].lo, blocks[i0 >> 6].hi);
+        const bool trivial = overlap == FrustumOverlap::Outside || (overlap == FrustumOverlap::Inside && params.minRatio2 <= 0.0f);
+
+        if (!trivial)
+        {
+            if (run < 0) run = i0;
+            continue;
+        }
+
+        if (run >= 0) { cullSpheres(spheres, run, i0, params, mask, level); run = -1; }
+
+        const int count = i1 - i0;
+        const std::uint64_t all = count == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << count) - 1;
+        mask[i0 >> 6] = overlap == FrustumOverlap::Inside ? all : 0;
+    }
+
+    if (run >= 0) cullSpheres(spheres, run, end, params, mask, level);
+}
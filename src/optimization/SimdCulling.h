@@ -0,0 +1,73 @@
+/*
+    SIMD culling header: batched sphere vs frustum (+ detail) tests over SoA streams, result as a bitmask.
+*/
+
+#pragma once
+
+#include "SimdDispatch.h"
+#include "Frustum.h"
+
+#include <glm.hpp>
+#include <cstdint>
+
+//Per-frame constants shared by every lane.
+struct CullParams
+{
+    FrustumPlane planes[6];
+    glm::vec3 eye{ 0.0f };
+    float minRatio2 = 0.0f;         //Detail cull: kept if r * r >= minRatio2 * |c - eye|^2, 0 = off.
+};
+
+//Sphere streams. With prevX set, the tested centre is prev * (1 - alpha) + cur * alpha, the same blend as
+//RenderState::getPosition, so the cull sees exactly what gets drawn.
+struct CullStreams
+{
+    const float* x = nullptr;
+    const float* y = nullptr;
+    const float* z = nullptr;
+    const float* r = nullptr;
+    const float* prevX = nullptr;   //nullptr = no blend, prevY/prevZ are then ignored.
+    const float* prevY = nullptr;
+    const float* prevZ = nullptr;
+    float alpha = 1.0f;
+};
+
+inline glm::vec3 cullCenter(const CullStreams& s, int i) //Tested centre of sphere i, one at a time.
+{
+    if (!s.prevX) return glm::vec3(s.x[i], s.y[i], s.z[i]);
+
+    const float keep = 1.0f - s.alpha;
+    return glm::vec3(s.prevX[i] * keep + s.x[i] * s.alpha,
+                     s.prevY[i] * keep + s.y[i] * s.alpha,
+                     s.prevZ[i] * keep + s.z[i] * s.alpha);
+}
+
+//Bounds of the spheres of one mask word (ids [64w, 64w + 64)), radius included, at both blend ends: valid
+//for any alpha. Ids are Morton sorted by SpatialReorder, so a block is a compact group of neighbouring grid
+//cells; drift between reorders only loosens its box.
+struct CullBlock
+{
+    glm::vec3 lo{ 0.0f };
+    glm::vec3 hi{ 0.0f };
+};
+
+//Mask layout: bit (i & 63) of mask[i >> 6] is set if sphere i is visible. begin must be a multiple of 64 so
+//ranges handed to different threads never share a word; the words covering [begin, end) are overwritten
+//and bits past end in the last one are cleared.
+
+//Scalar reference. Same tests and operation order as sphereIntersectsFrustum and the SIMD paths, so masks
+//match bit for bit.
+void cullSpheresScalar(const CullStreams& spheres, int begin, int end, const CullParams& params, std::uint64_t* mask);
+
+//Cull [begin,end) with the requested ISA: 4, 8 or 16 spheres per iteration, all six planes each
+//(falls back to the widest implemented path <= level).
+void cullSpheres(const CullStreams& spheres, int begin, int end, const CullParams& params, std::uint64_t* mask, SimdLevel level);
+
+//Block bounds for the words covering [begin,end), begin word aligned (written to blocks[begin >> 6] on).
+void computeCullBlocks(const CullStreams& spheres, int begin, int end, CullBlock* blocks, SimdLevel level);
+
+//Two-level cull, same mask as cullSpheres: blocks outside the frustum clear their word and blocks inside it
+//set it without touching their spheres. Only straddling blocks (or inside ones while the detail cull is on)
+//run the per-sphere kernel, so the cost follows the visible set plus the frustum's surface, not N.
+void cullSpheresBlocked(const CullStreams& spheres, const CullBlock* blocks, int begin, int end, const CullParams& params,
+                        std::uint64_t* mask, SimdLevel level);
@@ -0,0 +1,98 @@
+/*
+    SIMD dispatch header: runtime ISA detection and per-function target attributes for kernels.
+*/
+
+#pragma once
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#else
+#define SIMD_X86 0
+#endif
+
+//--SIMD-TARGET-ATTRIBUTES--
+//MSVC lets any function use any intrinsic, GCC/Clang need the ISA enabled per function instead of globally,
+//so the rest of the binary stays baseline x86-64 and only dispatched kernels use wider instructions.
+#if SIMD_X86 && !defined(_MSC_VER)
+#define SIMD_TARGET_SSE41  __attribute__((target("sse4.1")))
+#define SIMD_TARGET_AVX2   __attribute__((target("avx2")))
+#define SIMD_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define SIMD_TARGET_SSE41
+#define SIMD_TARGET_AVX2
+#define SIMD_TARGET_AVX512
+#endif
+//--SIMD-TARGET-ATTRIBUTES-END--
+
+enum class SimdLevel { Scalar = 0, SSE41 = 1, AVX2 = 2, AVX512 = 3 };
+
+inline const char* simdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::AVX512: return "AVX512";
+    case SimdLevel::AVX2:   return "AVX2";
+    case SimdLevel::SSE41:  return "SSE4.1";
+    default:                return "SCALAR";
+    }
+}
+
+//--CPU-DETECTION--
+//Widest ISA both the CPU and the OS (saved YMM/ZMM state) support. Detected once, then cached.
+inline SimdLevel detectSimdLevel()
+{
+    static const SimdLevel cached = []
+    {
+#if SIMD_X86
+        unsigned int r1[4] = { 0, 0, 0, 0 };
+        unsigned int r7[4] = { 0, 0, 0, 0 };
+
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        const int maxLeaf = info[0];
+        __cpuidex(info, 1, 0); for (int i = 0; i < 4; ++i) r1[i] = (unsigned)info[i];
+        if (maxLeaf >= 7) { __cpuidex(info, 7, 0); for (int i = 0; i < 4; ++i) r7[i] = (unsigned)info[i]; }
+#else
+        const unsigned int maxLeaf = __get_cpuid_max(0, nullptr);
+        __cpuid_count(1, 0, r1[0], r1[1], r1[2], r1[3]);
+        if (maxLeaf >= 7) __cpuid_count(7, 0, r7[0], r7[1], r7[2], r7[3]);
+#endif
+
+        const bool sse41 = (r1[2] & (1u << 19)) != 0;
+        const bool osxsave = (r1[2] & (1u << 27)) != 0;
+        const bool avx = (r1[2] & (1u << 28)) != 0;
+
+        unsigned long long xcr0 = 0;
+        if (osxsave)
+        {
+#if defined(_MSC_VER)
+            xcr0 = _xgetbv(0);
+#else
+            unsigned int lo = 0, hi = 0;
+            __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+            xcr0 = ((unsigned long long)hi << 32) | lo;
+#endif
+        }
+
+        const bool osYmm = (xcr0 & 0x6) == 0x6;     //XMM + YMM state saved by the OS.
+        const bool osZmm = (xcr0 & 0xE6) == 0xE6;   //Plus opmask + ZMM state.
+        const bool avx2 = avx && osYmm && (r7[1] & (1u << 5)) != 0;
+        const bool avx512f = avx2 && osZmm && (r7[1] & (1u << 16)) != 0;
+
+        if (avx512f) return SimdLevel::AVX512;
+        if (avx2) return SimdLevel::AVX2;
+        if (sse41) return SimdLevel::SSE41;
+#endif
+        return SimdLevel::Scalar;
+    }();
+
+    return cached;
+}
+//--CPU-DETECTION-END--
@@ -0,0 +1,165 @@
+/*
+    SIMD integrator implementation: scalar, SSE4.1 (4-wide) and AVX2 (8-wide) kernels.
+*/
+
+#include "SimdIntegrator.h"
+#include "../scene/ParticleStore.h"
+
+namespace
+{
+    struct Streams
+    {
+        float* p[3];
+        float* v[3];
+        const float* r;
+    };
+
+    inline Streams streamsOf(ParticleStore& particles)
+    {
+        return Streams{ { particles.px.data(), particles.py.data(), particles.pz.data() },
+                        { particles.vx.data(), particles.vy.data(), particles.vz.data() },
+                        particles.radius.data() };
+    }
+
+    //--SCALAR-KERNEL--
+    inline void integrateRangeScalar(const Streams& s, int begin, int end, const IntegrateParams& params)
+    {
+        const float dt = params.dt;
+        const float e = params.restitution;
+
+        for (int k = 0; k < 3; ++k) //Axis-major: one position/velocity stream pair per pass.
+        {
+            const float dv = (&params.gravity.x)[k] * dt;
+            const float boxLo = (&params.boxMin.x)[k];
+            const float boxHi = (&params.boxMax.x)[k];
+            float* p = s.p[k];
+            float* v = s.v[k];
+
+            for (int i = begin; i < end; ++i)
+            {
+                float vi = v[i] + dv;  //Euler.
+                float pi = p[i] + vi * dt;
+
+                const float lo = boxLo + s.r[i];
+                const float hi = boxHi - s.r[i];
+
+                if (pi < lo) { pi = lo; vi = -vi * e; } //Bounce with restitution on hit.
+                if (pi > hi) { pi = hi; vi = -vi * e; }
+
+                p[i] = pi;
+                v[i] = vi;
+            }
+        }
+    }
+    //--SCALAR-KERNEL-END--
+
+#if SIMD_X86
+    //--SSE41-KERNEL--
+    SIMD_TARGET_SSE41 int integrateRangeSSE41(const Streams& s, int begin, int end, const IntegrateParams& params)
+    {
+        const int vecEnd = begin + ((end - begin) & ~3);
+
+        const __m128 dt = _mm_set1_ps(params.dt);
+        const __m128 e = _mm_set1_ps(params.restitution);
+        const __m128 sign = _mm_set1_ps(-0.0f);
+
+        for (int k = 0; k < 3; ++k)
+        {
+            const __m128 dv = _mm_set1_ps((&params.gravity.x)[k] * params.dt);
+            const __m128 boxLo = _mm_set1_ps((&params.boxMin.x)[k]);
+            const __m128 boxHi = _mm_set1_ps((&params.boxMax.x)[k]);
+            float* p = s.p[k];
+            float* v = s.v[k];
+
+            for (int i = begin; i < vecEnd; i += 4)
+            {
+                const __m128 r = _mm_loadu_ps(s.r + i);
+                __m128 vi = _mm_add_ps(_mm_loadu_ps(v + i), dv);
+                __m128 pi = _mm_add_ps(_mm_loadu_ps(p + i), _mm_mul_ps(vi, dt));
+
+                const __m128 lo = _mm_add_ps(boxLo, r);
+                const __m128 hi = _mm_sub_ps(boxHi, r);
+
+                __m128 m = _mm_cmplt_ps(pi, lo);
+                pi = _mm_blendv_ps(pi, lo, m);
+                vi = _mm_blendv_ps(vi, _mm_mul_ps(_mm_xor_ps(vi, sign), e), m);
+
+                m = _mm_cmpgt_ps(pi, hi);
+                pi = _mm_blendv_ps(pi, hi, m);
+                vi = _mm_blendv_ps(vi, _mm_mul_ps(_mm_xor_ps(vi, sign), e), m);
+
+                _mm_storeu_ps(p + i, pi);
+                _mm_storeu_ps(v + i, vi);
+            }
+        }
+
+        return vecEnd; //Caller finishes the tail with the scalar kernel.
+    }
+    //--SSE41-KERNEL-END--
+
+    //--AVX2-KERNEL--
+    SIMD_TARGET_AVX2 int integrateRangeAVX2(const Streams& s, int begin, int end, const IntegrateParams& params)
+    {
+        const int vecEnd = begin + ((end - begin) & ~7);
+
+        const __m256 dt = _mm256_set1_ps(params.dt);
+        const __m256 e = _mm256_set1_ps(params.restitution);
+        const __m256 sign = _mm256_set1_ps(-0.0f);
+
+        for (int k = 0; k < 3; ++k)
+        {
+            const __m256 dv = _mm256_set1_ps((&params.gravity.x)[k] * params.dt);
+            const __m256 boxLo = _mm256_set1_ps((&params.boxMin.x)[k]);
+            const __m256 boxHi = _mm256_set1_ps((&params.boxMax.x)[k]);
+            float* p = s.p[k];
+            float* v = s.v[k];
+
+            for (int i = begin; i < vecEnd; i += 8) //8 spheres per iteration.
+            {
+                const __m256 r = _mm256_loadu_ps(s.r + i);
+                __m256 vi = _mm256_add_ps(_mm256_loadu_ps(v + i), dv);
+                __m256 pi = _mm256_add_ps(_mm256_loadu_ps(p + i), _mm256_mul_ps(vi, dt)); //No FMA: keeps parity with scalar.
+
+                const __m256 lo = _mm256_add_ps(boxLo, r);
+                const __m256 hi = _mm256_sub_ps(boxHi, r);
+
+                __m256 m = _mm256_cmp_ps(pi, lo, _CMP_LT_OQ);
+                pi = _mm256_blendv_ps(pi, lo, m);
+                vi = _mm256_blendv_ps(vi, _mm256_mul_ps(_mm256_xor_ps(vi, sign), e), m);
+
+                m = _mm256_cmp_ps(pi, hi, _CMP_GT_OQ);
+                pi = _mm256_blendv_ps(pi, hi, m);
+                vi = _mm256_blendv_ps(vi, _mm256_mul_ps(_mm256_xor_ps(vi, sign), e), m);
+
+                _mm256_storeu_ps(p + i, pi);
+                _mm256_storeu_ps(v + i, vi);
+            }
+        }
+
+        return vecEnd;
+    }
+    //--AVX2-KERNEL-END--
+#endif
+}
+
+void integrateWallsScalar(ParticleStore& particles, int begin, int end, const IntegrateParams& params)
+{
+    integrateRangeScalar(streamsOf(particles), begin, end, params);
+}
+
+void integrateWalls(ParticleStore& particles, int begin, int end, const IntegrateParams& params, SimdLevel level)
+{
+    if (end <= begin) return;
+
+    const Streams s = streamsOf(particles);
+    int tail = begin;
+
+#if SIMD_X86
+    if (level >= SimdLevel::AVX2)       tail = integrateRangeAVX2(s, begin, end, params);
+    else if (level >= SimdLevel::SSE41) tail = integrateRangeSSE41(s, begin, end, params);
+#else
+    (void)level;
+#endif
+
+    integrateRangeScalar(s, tail, end, params); //Remainder (or everything on the scalar path).
+}
@@ -0,0 +1,27 @@
+/*
+    SIMD integrator header: fused Euler step + cage wall clamp over SoA particle ranges.
+*/
+
+#pragma once
+
+#include "SimdDispatch.h"
+
+#include <glm.hpp>
+
+class ParticleStore;
+
+//Per-substep constants shared by every lane.
+struct IntegrateParams
+{
+    glm::vec3 gravity{ 0.0f, -9.81f, 0.0f };
+    float dt = 1.0f / 240.0f;
+    glm::vec3 boxMin{ 0.0f };
+    glm::vec3 boxMax{ 0.0f };
+    float restitution = 0.8f;
+};
+
+//Scalar reference. Same operation order as the SIMD paths so results match bit for bit.
+void integrateWallsScalar(ParticleStore& particles, int begin, int end, const IntegrateParams& params);
+
+//Integrate + clamp [begin,end) with the requested ISA (falls back to the widest implemented path <= level).
+void integrateWalls(ParticleStore& particles, int begin, int end, const IntegrateParams& params, SimdLevel level);
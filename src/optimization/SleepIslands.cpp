@@ -0,0 +1,211 @@
+/*
+    Sleep islands implementation: rest timers, concurrent union-find over contacts, island sleep/wake.
+*/
+
+#include "SleepIslands.h"
+#include "ContactSolver.h"
+
+#include <atomic>
+#include <numeric>
+
+int SleepIslands::find(int i)
+{
+    for (;;)
+    {
+        std::atomic_ref<int> link(parent[i]);
+        const int p = link.load(std::memory_order_relaxed);
+        if (p == i) return i;
+
+        const int gp = std::atomic_ref<int>(parent[p]).load(std::memory_order_relaxed);
+        int expected = p;
+        if (gp != p) link.compare_exchange_weak(expected, gp, std::memory_order_relaxed); //Path halving, losing the race is harmless.
+        i = gp;
+    }
+}
+
+void SleepIslands::unite(int a, int b)
+{
+    for (;;)
+    {
+        a = find(a);
+        b = find(b);
+        if (a == b) return;
+        if (a < b) std::swap(a, b); //Always hang the larger root under the smaller one: no cycles.
+
+        int expected = a;
+        if (std::atomic_ref<int>(parent[a]).compare_exchange_weak(expected, b, std::memory_order_relaxed)) return;
+    }
+}
+
+void SleepIslands::mergeChunkIds()
+{
+    awakeIds.clear();
+    sleeperIds.clear();
+
+    for (const std::vector<int>& ids : chunkAwakeIds) awakeIds.insert(awakeIds.end(), ids.begin(), ids.end());
+    for (const std::vector<int>& ids : chunkSleeperIds) sleeperIds.insert(sleeperIds.end(), ids.begin(), ids.end());
+}
+
+void SleepIslands::update(ThreadSystem& tasks, ParticleStore& particles, const ContactSolver& contacts, float dt)
+{
+    const int count = particles.size();
+    const int MIN_GRAIN = 4096;
+
+    if (!enabled) return;
+
+    const float* pX = particles.px.data(); const float* pY = particles.py.data(); const float* pZ = particles.pz.data();
+    float* rX = particles.restX.data(); float* rY = particles.restY.data(); float* rZ = particles.restZ.data();
+    float* vX = particles.vx.data(); float* vY = particles.vy.data(); float* vZ = particles.vz.data();
+    float* awake = particles.awake.data();
+    float* timer = particles.sleepTimer.data();
+    const float drift = linearThreshold * timeToSleep;
+    const float drift2 = drift * drift;
+    const float speed2 = linearThreshold * linearThreshold;
+
+    parent.resize(count);
+    islandResting.resize(count);
+    moving.resize(count);
+
+    //--REST-TIMERS--
+    tasks.parallelFor(0, count, MIN_GRAIN, [&](int i0, int i1, int)
+    {
+        for (int i = i0; i < i1; ++i)
+        {
+            std::uint8_t moved = 0;
+
+            if (awake[i] != 0.0f)
+            {
+                const float dx = pX[i] - rX[i], dy = pY[i] - rY[i], dz = pZ[i] - rZ[i];
+
+                if (dx * dx + dy * dy + dz * dz < drift2)
+                {
+                    timer[i] += dt;
+                }
+                else
+                {
+                    timer[i] = 0.0f; //Moved away: restart the window from here.
+                    rX[i] = pX[i]; rY[i] = pY[i]; rZ[i] = pZ[i];
+                    moved = 1;
+                }
+
+                if (vX[i] * vX[i] + vY[i] * vY[i] + vZ[i] * vZ[i] > speed2) moved = 1; //Sliding inside its window.
+            }
+
+            moving[i] = moved;
+            parent[i] = i;
+            islandResting[i] = 1;
+        }
+    });
+    //--REST-TIMERS-END--
+
+    //--CONTACT-ISLANDS--
+    contacts.forEachContactParallel(tasks, [&](int a, int b)
+    {
+        if (moving[a] | moving[b]) unite(a, b); //Resting neighbours stay apart; walls are static and never join.
+    });
+    //--CONTACT-ISLANDS-END--
+
+    //--ISLAND-RESTING--
+    tasks.parallelFor(0, count, MIN_GRAIN, [&](int i0, int i1, int)
+    {
+        for (int i = i0; i < i1; ++i)
+        {
+            if (timer[i] < timeToSleep)
+            {
+                std::atomic_ref<int>(islandResting[find(i)]).store(0, std::memory_order_relaxed); //Only ever cleared, order does not matter.
+            }
+        }
+    });
+    //--ISLAND-RESTING-END--
+
+    //--SLEEP-WAKE--
+    const int threads = tasks.getThreadCount();
+    chunkAwake.assign(threads, 0);
+    chunkRoots.assign(threads, 0);
+    chunkChanged.assign(threads, 0);
+    if ((int)chunkAwakeIds.size() != threads) { chunkAwakeIds.resize(threads); chunkSleeperIds.resize(threads); }
+    for (int k = 0; k < threads; ++k) { chunkAwakeIds[k].clear(); chunkSleeperIds[k].clear(); }
+
+    tasks.parallelFor(0, count, MIN_GRAIN, [&](int i0, int i1, int k)
+    {
+        int localRoots = 0, localChanged = 0;
+        std::vector<int>& awakeOut = chunkAwakeIds[k];
+        std::vector<int>& sleeperOut = chunkSleeperIds[k];
+
+        for (int i = i0; i < i1; ++i)
+        {
+            const int root = find(i);
+            localRoots += (root == i);
+
+            if (islandResting[root])
+            {
+                localChanged += (awake[i] != 0.0f);
+                awake[i] = 0.0f;
+                vX[i] = 0.0f; vY[i] = 0.0f; vZ[i] = 0.0f; //Sleepers hold still until woken.
+                sleeperOut.push_back(i);
+            }
+            else
+            {
+                if (awake[i] == 0.0f) //Woken by its island, must rest again before sleeping.
+                {
+                    timer[i] = 0.0f;
+                    rX[i] = pX[i]; rY[i] = pY[i]; rZ[i] = pZ[i];
+                    ++localChanged;
+                }
+                awake[i] = 1.0f;
+                awakeOut.push_back(i);
+            }
+        }
+
+        chunkAwake[k] += (int)awakeOut.size();
+        chunkRoots[k] += localRoots;
+        chunkChanged[k] += localChanged;
+    });
+
+    awakeCount = std::accumulate(chunkAwake.begin(), chunkAwake.end(), 0);
+    islandCount = std::accumulate(chunkRoots.begin(), chunkRoots.end(), 0);
+    changed = std::accumulate(chunkChanged.begin(), chunkChanged.end(), 0) > 0;
+    listCount = count;
+    mergeChunkIds(); //Chunks are in id order, so the lists come out ascending.
+    //--SLEEP-WAKE-END--
+}
+
+void SleepIslands::refreshIds(ThreadSystem& tasks, const ParticleStore& particles)
+{
+    const int count = particles.size();
+    const int threads = tasks.getThreadCount();
+
+    if (listCount != count) return; //No lists to keep up to date.
+
+    if ((int)chunkAwakeIds.size() != threads) { chunkAwakeIds.resize(threads); chunkSleeperIds.resize(threads); }
+    for (int k = 0; k < threads; ++k) { chunkAwakeIds[k].clear(); chunkSleeperIds[k].clear(); }
+
+    tasks.parallelFor(0, count, 4096, [&](int i0, int i1, int k)
+    {
+        for (int i = i0; i < i1; ++i)
+        {
+            if (particles.awake[i] != 0.0f) chunkAwakeIds[k].push_back(i);
+            else chunkSleeperIds[k].push_back(i);
+        }
+    });
+
+    mergeChunkIds();
+}
+
+void SleepIslands::wakeAll(ThreadSystem& tasks, ParticleStore& particles)
+{
+    tasks.parallelFor(0, particles.size(), 4096, [&](int i0, int i1, int)
+    {
+        for (int i = i0; i < i1; ++i)
+        {
+            particles.awake[i] = 1.0f;
+            particles.sleepTimer[i] = 0.0f;
+            particles.restX[i] = particles.px[i]; particles.restY[i] = particles.py[i]; particles.restZ[i] = particles.pz[i];
+        }
+    });
+
+    awakeCount = particles.size();
+    changed = !sleeperIds.empty();
+    awakeIds.clear();
+    sleeperIds.clear();
+}
@@ -0,0 +1,68 @@
+/*
+    Sleep islands header: resting-sphere deactivation with contact-graph islands that sleep and wake together.
+*/
+
+#pragma once
+
+#include "ThreadSystem.h"
+#include "../scene/ParticleStore.h"
+
+#include <cstdint>
+#include <vector>
+
+class ContactSolver;
+
+//A sphere becomes a sleep candidate once its average speed over a `timeToSleep` window stayed below
+//`linearThreshold`, i.e. it never left a ball of radius linearThreshold * timeToSleep around its rest
+//anchor. Averaging matters: deep piles keep a per-substep velocity residue that never settles even
+//though nothing actually moves.
+//Islands come from the contact list of the last build via a lock-free union-find, but only contacts with a
+//moving sphere (left its anchor this substep, or faster than linearThreshold) join them. A pile at rest so
+//splits into single spheres that sleep on their own timers, while a sphere sliding over it holds the spheres
+//it touches awake with it, and an island only sleeps when every member is a candidate. A moving sphere that
+//touches a sleeper wakes it; the sleeper spreads the wake further only if it then moves itself.
+//Sleepers have no inverse mass in the solver and do not move. PhysicsPipeline integrates and bins only
+//getAwakeIds() and keeps the sleepers in a grid of their own, rebuilt only when getSleeperIds() changes.
+class SleepIslands
+{
+public:
+    float linearThreshold = 0.05f;  //Average speed (m/s) over the window below which a sphere counts as resting.
+    float timeToSleep = 0.5f;       //Seconds a sphere must rest before its island may sleep.
+    bool enabled = true;            //Off: update() does nothing, the caller runs wakeAll() once.
+
+    //Once per substep after the contact solve: update timers, build islands, sleep/wake whole islands.
+    void update(ThreadSystem& tasks, ParticleStore& particles, const ContactSolver& contacts, float dt);
+
+    void wakeAll(ThreadSystem& tasks, ParticleStore& particles);    //E.g. when switching to a solver without a contact list.
+    void refreshIds(ThreadSystem& tasks, const ParticleStore& particles); //Rebuild the id lists after the spheres were permuted.
+
+    int getAwakeCount() const { return awakeCount; }
+    bool allAsleep() const { return awakeCount == 0; }            //Nothing can move: integrate/broadphase/solve may be skipped.
+    int getIslandCount() const { return islandCount; }
+
+    //Ascending ids of the awake spheres of `count`, nullptr while every one of them is awake (or the lists
+    //were built for another count).
+    const std::vector<int>* getAwakeIds(int count) const { return (listCount == count && awakeCount >= 0 && awakeCount < count) ? &awakeIds : nullptr; }
+    const std::vector<int>& getSleeperIds() const { return sleeperIds; }  //Ascending, the complement of getAwakeIds().
+    bool sleepersChanged() const { return changed; }                       //Some sphere fell asleep or woke in the last update.
+
+private:
+    int find(int i);                //Root with path halving (atomic, safe while other threads unite).
+    void unite(int a, int b);       //Link the larger root under the smaller one (CAS, retries on contention).
+    void mergeChunkIds();           //chunkAwakeIds/chunkSleeperIds -> awakeIds/sleeperIds, chunk order.
+
+    std::vector<int> parent;        //Union-find forest over particle ids.
+    std::vector<int> islandResting; //Per root: 1 while every member is a sleep candidate.
+    std::vector<std::uint8_t> moving; //Per sphere: moved this substep, its contacts join islands.
+    std::vector<int> chunkAwake;    //Per parallelFor chunk awake/root/changed counts (reduced after the pass).
+    std::vector<int> chunkRoots;
+    std::vector<int> chunkChanged;
+    std::vector<std::vector<int>> chunkAwakeIds;    //Per-chunk id lists, ascending within a chunk.
+    std::vector<std::vector<int>> chunkSleeperIds;
+    std::vector<int> awakeIds;
+    std::vector<int> sleeperIds;
+    int listCount = -1;             //Sphere count the id lists were built for.
+    int awakeCount = -1;            //-1 until the first update (everything starts awake).
+    int islandCount = 0;
+    bool changed = false;
+};
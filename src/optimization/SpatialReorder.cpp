@@ -0,0 +1,65 @@
+/*
+    Spatial reorder implementation: Morton keys, parallel radix sort, and stream gather.
+*/
+
+#include "SpatialReorder.h"
+#include "RadixSort.h"
+#include "Morton.h"
+
+void SpatialReorder::observe(float idSpread)
+{
+    if (baseline < 0.0f)
+    {
+        baseline = idSpread; //First sample after a reorder is the reference.
+        return;
+    }
+
+    if (idSpread > baseline * degradeFactor) pending = true;
+}
+
+void SpatialReorder::reorder(ThreadSystem& tasks, ParticleStore& particles, const glm::vec3& origin, float cellSize)
+{
+    const int count = particles.size();
+    const float invCellSize = 1.0f / cellSize;
+    const int MIN_GRAIN = 4096;
+
+    keys.resize(count);
+    values.resize(count);
+
+    //--MORTON-KEYS--
+    tasks.parallelFor(0, count, MIN_GRAIN, [&](int i0, int i1, int)
+    {
+        for (int i = i0; i < i1; ++i)
+        {
+            keys[i] = mortonOfCell(particles.getPosition(i), origin, invCellSize);
+            values[i] = static_cast<std::uint32_t>(i);
+        }
+    });
+    //--MORTON-KEYS-END--
+
+    parallelRadixSort(tasks, keys, values, tmpKeys, tmpValues, 30); //Stable, so ids inside a cell keep their relative order.
+
+    //--PERMUTE-STREAMS--
+    newToOld.resize(count);
+    oldToNew.resize(count);
+    scratch.resize(count);
+
+    tasks.parallelFor(0, count, MIN_GRAIN, [&](int i0, int i1, int)
+    {
+        for (int i = i0; i < i1; ++i)
+        {
+            newToOld[i] = static_cast<int>(values[i]);
+            oldToNew[values[i]] = i;
+        }
+
+        scratch.gather(particles, newToOld.data(), i0, i1);
+    });
+
+    particles.swap(scratch);
+    //--PERMUTE-STREAMS-END--
+
+    substeps = 0;
+    pending = false;
+    baseline = -1.0f;
+    ++reorderCount;
+}
@@ -0,0 +1,45 @@
+/*
+    Spatial reorder header: periodic Morton-order permutation of particle storage for memory locality.
+*/
+
+#pragma once
+
+#include "ThreadSystem.h"
+#include "../scene/ParticleStore.h"
+
+#include <glm.hpp>
+#include <vector>
+#include <cstdint>
+
+//Keeps spatial neighbours close in memory. Particles are sorted by the Morton code of their grid cell
+//every `interval` substeps, or earlier when the grid's id spread degrades past `degradeFactor` times the
+//value measured right after the last reorder. Callers remap their own id-based state with getOldToNew().
+class SpatialReorder
+{
+public:
+    int interval = 240;             //Force a reorder every K substeps (0 = only on degradation).
+    int sampleEvery = 30;           //Substeps between locality samples.
+    float degradeFactor = 4.0f;     //Reorder early when the spread grows past this multiple of the baseline.
+
+    void tick() { ++substeps; }                                              //Call once per substep.
+    bool sampleDue() const { return sampleEvery > 0 && substeps % sampleEvery == 0; }
+    void observe(float idSpread);                                           //Feed UniformGrid::measureIdSpread().
+    bool due() const { return pending || (interval > 0 && substeps >= interval); }
+
+    //Sort by cell Morton code and permute every particle stream. Fills the old/new id maps.
+    void reorder(ThreadSystem& tasks, ParticleStore& particles, const glm::vec3& origin, float cellSize);
+
+    const std::vector<int>& getOldToNew() const { return oldToNew; }
+    const std::vector<int>& getNewToOld() const { return newToOld; }
+    int getReorderCount() const { return reorderCount; }
+
+private:
+    int substeps = 0;
+    bool pending = false;
+    float baseline = -1.0f;         //Spread right after the last reorder (< 0 = not sampled yet).
+    int reorderCount = 0;
+
+    std::vector<std::uint32_t> keys, values, tmpKeys, tmpValues; //Radix sort buffers, reused.
+    std::vector<int> oldToNew, newToOld;
+    ParticleStore scratch;          //Gather target, swapped with the live store.
+};
@@ -0,0 +1,173 @@
+/*
+    Sweep-and-prune implementation: axis choice, bound refresh, coherent insertion sort, slab coloring.
+*/
+
+#include "SweepAndPrune.h"
+
+#include <algorithm>
+
+void SweepAndPrune::chooseAxis(const ParticleStore& particles)
+{
+    //--AXIS-VARIANCE-- (serial on purpose: a fixed summation order keeps the choice thread-count independent)
+    const int count = particles.size();
+    const AlignedFloats* streams[3] = { &particles.px, &particles.py, &particles.pz };
+
+    int best = 0;
+    double bestVariance = -1.0;
+
+    for (int k = 0; k < 3; ++k)
+    {
+        const float* p = streams[k]->data();
+        double sum = 0.0, sum2 = 0.0;
+
+        for (int i = 0; i < count; ++i) { sum += p[i]; sum2 += double(p[i]) * p[i]; }
+
+        const double mean = sum / std::max(count, 1);
+        const double variance = sum2 / std::max(count, 1) - mean * mean;
+
+        if (variance > bestVariance) { bestVariance = variance; best = k; }
+    }
+    //--AXIS-VARIANCE-END--
+
+    axis = best;
+}
+
+void SweepAndPrune::build(ThreadSystem& tasks, const ParticleStore& particles)
+{
+    const int count = particles.size();
+    const int chunkSlots = tasks.getThreadCount();
+    const int MIN_GRAIN = 4096;
+
+    //--AXIS-CHECK--
+    bool fullSort = false;
+
+    if ((int)endpoints.size() != count || axis < 0) //First build or a different particle set: start over.
+    {
+        endpoints.resize(count);
+        for (int i = 0; i < count; ++i) endpoints[i].id = i;
+        chooseAxis(particles);
+        fullSort = true;
+    }
+    else if (axisInterval > 0 && ++substeps >= axisInterval)
+    {
+        substeps = 0;
+        const int previous = axis;
+        chooseAxis(particles);
+        fullSort = (axis != previous);
+    }
+    //--AXIS-CHECK-END--
+
+    //--BOUNDS-REFRESH-- (parallel, in sorted order so the sort below sees mostly-sorted keys)
+    const AlignedFloats* streams[3] = { &particles.px, &particles.py, &particles.pz };
+    const float* center = streams[axis]->data();
+    const float* crossU = streams[(axis + 1) % 3]->data();
+    const float* crossV = streams[(axis + 2) % 3]->data();
+    const float* rad = particles.radius.data();
+    const float halfMargin = 0.5f * margin;
+
+    chunkMaxRadius.assign(chunkSlots, 0.0f);
+
+    tasks.parallelFor(0, count, MIN_GRAIN, [&](int i0, int i1, int k)
+    {
+        float maxRadius = 0.0f;
+
+        for (int i = i0; i < i1; ++i)
+        {
+            Endpoint& e = endpoints[i];
+            e.r = rad[e.id];
+            e.lo = center[e.id] - e.r - halfMargin;
+            e.hi = center[e.id] + e.r + halfMargin;
+            e.u = crossU[e.id];
+            e.v = crossV[e.id];
+            maxRadius = std::max(maxRadius, e.r);
+        }
+
+        chunkMaxRadius[k] = maxRadius;
+    });
+
+    const float maxRadius = *std::max_element(chunkMaxRadius.begin(), chunkMaxRadius.end());
+    slabWidth = std::max(2.0f * maxRadius + margin, 1e-6f); //Longest interval: a partner is at most one slab ahead.
+    //--BOUNDS-REFRESH-END--
+
+    //--COHERENT-INSERTION-SORT-- (falls back to a full sort when the order changed too much)
+    auto byLo = [](const Endpoint& a, const Endpoint& b) { return a.lo < b.lo; };
+
+    if (!fullSort)
+    {
+        const long long budget = 32ll * count; //~32 moves per sphere; past that std::sort is cheaper.
+        long long swaps = 0;
+
+        for (int i = 1; i < count && swaps <= budget; ++i)
+        {
+            const Endpoint key = endpoints[i];
+            int j = i - 1;
+
+            while (j >= 0 && endpoints[j].lo > key.lo) { endpoints[j + 1] = endpoints[j]; --j; }
+
+            endpoints[j + 1] = key;
+            swaps += i - 1 - j;
+        }
+
+        lastSwaps = swaps;
+        fullSort = (swaps > budget);
+    }
+
+    if (fullSort)
+    {
+        std::sort(endpoints.begin(), endpoints.end(), byLo);
+        lastSwaps = -1;
+    }
+    //--COHERENT-INSERTION-SORT-END--
+
+    buildSlabs();
+}
+
+void SweepAndPrune::buildSlabs()
+{
+    //--SLAB-CUT--
+    slabStart.clear();
+    slabParity.clear();
+
+    const int count = static_cast<int>(endpoints.size());
+    if (count == 0)
+    {
+        slabStart.push_back(0);
+        colorSlabs.clear();
+        colorStart.assign(SLAB_COLOR_COUNT + 1, 0);
+        return;
+    }
+
+    const float origin = endpoints[0].lo;
+    const float invWidth = 1.0f / slabWidth;
+    long long currentSlab = -1;
+
+    for (int i = 0; i < count; ++i)
+    {
+        const long long slab = static_cast<long long>((endpoints[i].lo - origin) * invWidth);
+        if (slab != currentSlab)
+        {
+            slabStart.push_back(i);
+            slabParity.push_back(static_cast<int>(slab & 1));
+            currentSlab = slab;
+        }
+    }
+
+    slabStart.push_back(count); //Sentinel.
+    //--SLAB-CUT-END--
+
+    //--SLAB-COLORS--
+    const int slabCount = static_cast<int>(slabParity.size());
+    colorStart.assign(SLAB_COLOR_COUNT + 1, 0);
+    for (int s = 0; s < slabCount; ++s) ++colorStart[slabParity[s] + 1];
+    colorStart[2] += colorStart[1];
+
+    colorSlabs.resize(slabCount);
+    int cursor[SLAB_COLOR_COUNT] = { colorStart[0], colorStart[1] };
+    for (int s = 0; s < slabCount; ++s) colorSlabs[cursor[slabParity[s]]++] = s;
+    //--SLAB-COLORS-END--
+}
+
+void SweepAndPrune::remapIds(const std::vector<int>& oldToNew)
+{
+    for (Endpoint& e : endpoints) e.id = oldToNew[e.id]; //Positions did not change, the order is still sorted.
+}
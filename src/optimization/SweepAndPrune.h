@@ -0,0 +1,132 @@
+/*
+    Sweep-and-prune header: persistent sorted interval list on one axis, updated by insertion sort.
+*/
+
+#pragma once
+
+#include "ThreadSystem.h"
+#include "../scene/ParticleStore.h"
+
+#include <vector>
+#include <cmath>
+
+//Alternative broadphase to UniformGrid. Every sphere is an interval [c - r, c + r] on the sweep axis (the
+//axis with the largest position variance, re-checked every axisInterval substeps). The list stays sorted
+//across substeps, so each build only refreshes the bounds and runs an insertion sort, which is close to
+//O(n) while spheres move less than their spacing per substep. A pair is reported when the intervals overlap
+//on the sweep axis and the spheres overlap on the other two.
+//
+//Colors: the sorted list is cut into slabs at least one interval wide (2 * max radius + margin) by lower
+//bound. A pair belongs to the slab of its lower interval; the partner starts before that interval ends, so
+//it lies in the same or the next slab. Even and odd slabs therefore never share a sphere, which gives the
+//same lock-free colored interface as the grids (ContactSolver, colored direct solve).
+class SweepAndPrune
+{
+public:
+    int axisInterval = 60;          //Substeps between sweep-axis checks (a change triggers a full sort).
+    float margin = 0.0f;            //Intervals are widened by this so near-touching pairs are kept (speculative contacts).
+
+    void build(ThreadSystem& tasks, const ParticleStore& particles);   //Refresh bounds, re-sort, cut slabs.
+    void remapIds(const std::vector<int>& oldToNew);                   //Keep the sorted order after a storage permutation.
+
+    int getAxis() const { return axis; }
+    long long getLastSwapCount() const { return lastSwaps; }           //Insertion sort moves in the last build (-1 = full sort).
+
+    //--COLORED-SOURCE-- (same shape as UniformGrid's, consumed by ContactSolver::build)
+    static constexpr int SLAB_COLOR_COUNT = 2;
+    int getColorCount() const { return SLAB_COLOR_COUNT; }
+    bool hasColorClasses() const { return (int)colorStart.size() == SLAB_COLOR_COUNT + 1; }
+    int getColorClassBegin(int color) const { return colorStart[color]; }
+    int getColorClassEnd(int color) const { return colorStart[color + 1]; }
+
+    template<typename GetPos, typename GetRad, typename Fn>
+    void forEachPotentialPairInColorCell(int idx, GetPos& /*getPos*/, GetRad& /*getRad*/, Fn& fn) const
+    {
+        const int slab = colorSlabs[idx];
+        for (int i = slabStart[slab]; i < slabStart[slab + 1]; ++i) sweepFrom(i, fn);
+    }
+    //--COLORED-SOURCE-END--
+
+    //Enumerate potential pairs, each once.
+    template<typename Fn>
+    void forEachPotentialPair(Fn&& fn) const
+    {
+        for (int i = 0; i < (int)endpoints.size(); ++i) sweepFrom(i, fn);
+    }
+
+    //Same as above, but split across the thread pool (fn must synchronize if it writes).
+    template<typename Fn>
+    void forEachPotentialPairParallel(ThreadSystem& tasks, Fn&& fn) const
+    {
+        tasks.parallelFor(0, (int)endpoints.size(), 256, [&](int begin, int end, int)
+        {
+            for (int i = begin; i < end; ++i) sweepFrom(i, fn);
+        });
+    }
+
+    //Interface match for UniformGrid: the sweep is already pruned on all three axes.
+    template<typename GetPos, typename GetRad, typename Fn>
+    void forEachPotentialPairPrunedParallel(ThreadSystem& tasks, GetPos /*getPos*/, GetRad /*getRad*/, Fn&& fn) const
+    {
+        tasks.parallelFor(0, (int)endpoints.size(), 256, [&](int begin, int end, int)
+        {
+            for (int i = begin; i < end; ++i) sweepFrom(i, fn);
+        });
+    }
+
+    //Lock-free variant: even slabs, barrier, odd slabs.
+    template<typename GetPos, typename GetRad, typename Fn>
+    void forEachPotentialPairColoredParallel(ThreadSystem& tasks, GetPos getPos, GetRad getRad, Fn&& fn) const
+    {
+        if (!hasColorClasses()) return;
+
+        for (int color = 0; color < SLAB_COLOR_COUNT; ++color)
+        {
+            tasks.parallelFor(colorStart[color], colorStart[color + 1], 1, [&](int begin, int end, int)
+            {
+                for (int idx = begin; idx < end; ++idx) forEachPotentialPairInColorCell(idx, getPos, getRad, fn);
+            }); //parallelFor blocks, which is the barrier between the two classes.
+        }
+    }
+
+private:
+    struct Endpoint
+    {
+        float lo, hi;               //Interval on the sweep axis (radius + margin / 2 each side).
+        float u, v, r;              //Center on the two other axes and radius, cached so the sweep never leaves the list.
+        int id;                     //Sphere id.
+    };
+
+    //Pairs whose lower interval is endpoints[i]: walk forward until intervals stop overlapping. The box test
+    //reads the copies refreshed in build(), so the getPos/getRad of the shared interface are not needed.
+    template<typename Fn>
+    void sweepFrom(int i, Fn& fn) const
+    {
+        const Endpoint& e = endpoints[i];
+        const float radA = e.r + margin;
+        const int count = static_cast<int>(endpoints.size());
+
+        for (int j = i + 1; j < count && endpoints[j].lo <= e.hi; ++j)
+        {
+            const Endpoint& b = endpoints[j];
+            const float reach = radA + b.r;
+
+            if (std::abs(b.u - e.u) <= reach && std::abs(b.v - e.v) <= reach) fn(e.id, b.id); //Overlap on the two other axes.
+        }
+    }
+
+    void chooseAxis(const ParticleStore& particles); //Largest variance of sphere centers.
+    void buildSlabs();
+
+    std::vector<Endpoint> endpoints;    //Sorted by lo, persistent across builds.
+    std::vector<int> slabStart;         //Non-empty slabs: slab s owns endpoints[slabStart[s], slabStart[s + 1]).
+    std::vector<int> slabParity;        //Absolute slab index & 1 per non-empty slab.
+    std::vector<int> colorSlabs;        //Slabs grouped by parity.
+    std::vector<int> colorStart;        //Color c owns colorSlabs[colorStart[c], colorStart[c + 1]).
+    std::vector<float> chunkMaxRadius;  //Per-chunk reduction scratch.
+
+    float slabWidth = 1.0f;
+    int axis = -1;                      //-1 = never sorted.
+    int substeps = 0;
+    long long lastSwaps = 0;
+};
@@ -0,0 +1,217 @@
+/*
+    Task graph implementation: edge derivation from resource sets, lane scheduling over the thread pool.
+*/
+
+#include "TaskGraph.h"
+
+namespace
+{
+    thread_local int stageDepth = 0; //>0 while this thread runs a stage.
+}
+
+void TaskGraph::clear()
+{
+    nodes.clear();
+    edges.clear();
+    dependents.clear();
+
+    for (ResourceState& r : resources)
+    {
+        r.lastWriter = -1;
+        r.readers.clear();
+    }
+}
+
+void TaskGraph::addEdge(int from, int to)
+{
+    if (from < 0 || from == to) return;
+
+    for (int e = (int)edges.size() - 1; e >= 0 && edges[e].second == to; --e)
+    {
+        if (edges[e].first == from) return; //Already depends on it through another resource.
+    }
+
+    edges.emplace_back(from, to);
+    ++nodes[to].dependencyCount;
+}
+
+int TaskGraph::addNode(const Node& node, std::initializer_list<int> reads, std::initializer_list<int> writes)
+{
+    const int index = (int)nodes.size();
+    nodes.push_back(node);
+
+    for (int r : reads)
+    {
+        if (r >= (int)resources.size()) resources.resize(r + 1);
+        addEdge(resources[r].lastWriter, index); //Read after write.
+    }
+
+    for (int r : writes)
+    {
+        if (r >= (int)resources.size()) resources.resize(r + 1);
+        ResourceState& state = resources[r];
+
+        addEdge(state.lastWriter, index);                           //Write after write.
+        for (int reader : state.readers) addEdge(reader, index);    //Write after read.
+
+        state.lastWriter = index;
+        state.readers.clear();
+    }
+
+    for (int r : reads)
+    {
+        ResourceState& state = resources[r];
+        if (state.lastWriter != index) state.readers.push_back(index); //A stage that also writes r is its writer, not a reader.
+    }
+
+    return index;
+}
+
+void TaskGraph::finalize()
+{
+    //--DEPENDENT-RANGES-- (counting sort of the edge list by source)
+    for (Node& node : nodes) node.dependentCount = 0;
+    for (const std::pair<int, int>& e : edges) ++nodes[e.first].dependentCount;
+
+    int offset = 0;
+    for (Node& node : nodes)
+    {
+        node.firstDependent = offset;
+        offset += node.dependentCount;
+        node.dependentCount = 0;
+    }
+
+    dependents.resize(edges.size());
+    for (const std::pair<int, int>& e : edges)
+    {
+        Node& from = nodes[e.first];
+        dependents[from.firstDependent + from.dependentCount++] = e.second;
+    }
+    //--DEPENDENT-RANGES-END--
+
+    //--FEEDS-MAIN-- (edges always point to a later stage, so one backwards sweep sees every dependent first)
+    for (int i = (int)nodes.size() - 1; i >= 0; --i)
+    {
+        Node& node = nodes[i];
+        node.feedsMain = false;
+
+        for (int d = node.firstDependent; d < node.firstDependent + node.dependentCount; ++d)
+        {
+            const Node& dependent = nodes[dependents[d]];
+            if (dependent.affinity == Affinity::Main || dependent.feedsMain) { node.feedsMain = true; break; }
+        }
+    }
+    //--FEEDS-MAIN-END--
+}
+
+void TaskGraph::run(ThreadSystem& tasks)
+{
+    const int count = (int)nodes.size();
+    if (count == 0) return;
+
+    finalize();
+
+    if (count > atomicCapacity)
+    {
+        pending.reset(new std::atomic<int>[count]);
+        claimed.reset(new std::atomic<int>[count]);
+        atomicCapacity = count;
+    }
+
+    int mainCount = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        pending[i].store(nodes[i].dependencyCount, std::memory_order_relaxed);
+        claimed[i].store(0, std::memory_order_relaxed);
+        mainCount += nodes[i].affinity == Affinity::Main ? 1 : 0;
+    }
+    const int anyCount = count - mainCount;
+
+    finished.store(0, std::memory_order_relaxed);
+    unclaimedAny.store(anyCount, std::memory_order_relaxed);
+    unclaimedMain = mainCount;
+    callerMayPreferWorker = tasks.getThreadCount() == 1;
+    caller = std::this_thread::get_id();
+
+    //One lane per Any stage at most, more would only spin. Publishing the lanes orders the stores above.
+    tasks.parallelLanes(1 + anyCount, [this, &tasks](int)
+    {
+        lane(tasks, std::this_thread::get_id() == caller);
+    });
+}
+
+void TaskGraph::lane(ThreadSystem& tasks, bool isCaller)
+{
+    //A lane stolen by a thread that is inside a stage (helping its parallelFor) must not wait here: the stage
+    //below it on the stack may be what the lane is waiting for.
+    if (stageDepth > 0) return;
+
+    const int count = (int)nodes.size();
+    int idleRounds = 0;
+
+    while (finished.load(std::memory_order_acquire) < count)
+    {
+        if (!isCaller && unclaimedAny.load(std::memory_order_acquire) == 0) return; //Only Main stages left.
+
+        const int index = claimReady(isCaller);
+        if (index >= 0)
+        {
+            execute(index);
+            idleRounds = 0;
+            continue;
+        }
+
+        tasks.helpOnce(idleRounds); //Chunks of a running stage's parallelFor, or a short backoff.
+    }
+}
+
+int TaskGraph::claimReady(bool isCaller)
+{
+    const int count = (int)nodes.size();
+
+    //The caller looks at Main stages first: nobody else can run them, and they carry the GL submission.
+    for (int pass = isCaller ? 0 : 1; pass < 2; ++pass)
+    {
+        const bool wantMain = pass == 0;
+
+        for (int i = 0; i < count; ++i)
+        {
+            const Node& node = nodes[i];
+            if ((node.affinity == Affinity::Main) != wantMain) continue;
+
+            //A PreferWorker stage that is ready before a worker woke would otherwise hold up clear/upload/draw
+            //for its whole run. Taking it anyway when a Main stage waits on it keeps the frame from stalling.
+            if (isCaller && node.affinity == Affinity::PreferWorker && unclaimedMain > 0 && !node.feedsMain && !callerMayPreferWorker) continue;
+
+            if (claimed[i].load(std::memory_order_relaxed) != 0 || pending[i].load(std::memory_order_acquire) != 0) continue;
+
+            int expected = 0;
+            if (!claimed[i].compare_exchange_strong(expected, 1, std::memory_order_acq_rel)) continue; //Another lane got it.
+
+            if (wantMain) --unclaimedMain;
+            else unclaimedAny.fetch_sub(1, std::memory_order_acq_rel);
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void TaskGraph::execute(int index)
+{
+    const Node& node = nodes[index];
+
+    ++stageDepth;
+    {
+        PROFILE_SCOPE(node.name);
+        node.invoke(node.context);
+    }
+    --stageDepth;
+
+    for (int d = node.firstDependent; d < node.firstDependent + node.dependentCount; ++d)
+    {
+        pending[dependents[d]].fetch_sub(1, std::memory_order_acq_rel); //Releases this stage's writes to the dependent.
+    }
+
+    finished.fetch_add(1, std::memory_order_acq_rel);
+}
@@ -0,0 +1,96 @@
+/*
+    Task graph header: stages declare the resources they read and write, the scheduler derives the edges.
+*/
+
+#pragma once
+
+#include "ThreadSystem.h"
+
+#include <atomic>
+#include <initializer_list>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//A frame is a list of stages added in program order. Each stage names the resources (small integers, the
+//caller's enum) it reads and writes, and gets an edge from the last writer of everything it touches and from
+//every reader since that writer for what it writes (read-after-write, write-after-read, write-after-write).
+//Stages that share nothing run at the same time.
+//
+//run() is one blocking ThreadSystem::parallelLanes call: the calling thread runs every Main stage (GL, window
+//input) plus any ready Any stage, pool lanes run Any and PreferWorker stages. The caller leaves a PreferWorker
+//stage to the pool while it still has Main stages to claim, so a long stage (physics) does not land on the
+//main thread just because it became ready before a worker woke up. A lane with nothing ready helps the pool,
+//so a stage that calls parallelFor itself still gets every idle worker.
+//
+//Stages are held by reference: add() takes lvalues only, and they must outlive run(). Rebuild with clear()
+//every frame; vectors keep their capacity, so a steady frame allocates nothing.
+class TaskGraph
+{
+public:
+    enum class Affinity
+    {
+        Any,            //Any lane, including the caller.
+        PreferWorker,   //Pool lanes; the caller only once its Main stages are claimed, a Main stage waits on it,
+                        //or the pool has a single worker.
+        Main            //Only the thread that calls run().
+    };
+
+    void clear();
+
+    template<typename Fn>
+    int add(const char* name, Affinity affinity, std::initializer_list<int> reads, std::initializer_list<int> writes, Fn& fn)
+    {
+        Node node;
+        node.name = name;
+        node.affinity = affinity;
+        node.invoke = [](void* context) { (*static_cast<Fn*>(context))(); };
+        node.context = static_cast<void*>(&fn);
+        return addNode(node, reads, writes);
+    }
+
+    void run(ThreadSystem& tasks); //Blocks until every stage ran.
+
+    int getStageCount() const { return static_cast<int>(nodes.size()); }
+
+private:
+    struct Node
+    {
+        const char* name = nullptr;
+        Affinity affinity = Affinity::Any;
+        bool feedsMain = false;                         //A Main stage depends on it, directly or not (finalize()).
+        void (*invoke)(void* context) = nullptr;
+        void* context = nullptr;
+        int dependencyCount = 0;
+        int firstDependent = 0, dependentCount = 0;     //Range in `dependents`, filled by finalize().
+    };
+
+    struct ResourceState
+    {
+        int lastWriter = -1;
+        std::vector<int> readers;                       //Since lastWriter.
+    };
+
+    int addNode(const Node& node, std::initializer_list<int> reads, std::initializer_list<int> writes);
+    void addEdge(int from, int to);
+    void finalize();                                    //Edge list -> per-node dependent ranges, feedsMain.
+    void lane(ThreadSystem& tasks, bool isCaller);
+    int claimReady(bool isCaller);                      //-1 if nothing runnable right now.
+    void execute(int index);
+
+    std::vector<Node> nodes;
+    std::vector<ResourceState> resources;
+    std::vector<std::pair<int, int>> edges;             //(from, to), deduplicated per stage.
+    std::vector<int> dependents;
+
+    std::unique_ptr<std::atomic<int>[]> pending;        //Unfinished dependencies per node.
+    std::unique_ptr<std::atomic<int>[]> claimed;        //0/1 per node.
+    int atomicCapacity = 0;
+
+    std::atomic<int> finished{ 0 };
+    std::atomic<int> unclaimedAny{ 0 };                 //Pool lanes leave once this hits zero (Any and PreferWorker).
+    int unclaimedMain = 0;                              //Touched by the caller thread only.
+    bool callerMayPreferWorker = false;                 //Single-worker pool: no point keeping the caller off them.
+    std::thread::id caller;
+};
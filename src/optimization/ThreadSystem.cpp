@@ -0,0 +1,230 @@
+/*
+    Work-stealing thread pool implementation: worker loop, stealing, spin-then-sleep idling.
+*/
+
+#include "ThreadSystem.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define THREAD_SYSTEM_PAUSE() _mm_pause()
+#else
+#define THREAD_SYSTEM_PAUSE() ((void)0)
+#endif
+
+//--POOL-IDENTITY--
+namespace
+{
+    thread_local const ThreadSystem* currentPool = nullptr;    //Pool the calling thread works for, if any.
+    thread_local int currentIndex = -1;                         //Its deque index in that pool.
+
+    const int SPIN_PAUSES = 64;     //Idle rounds with a pause instruction...
+    const int SPIN_YIELDS = 256;    //...then rounds that yield the core before going to sleep.
+
+    inline void backoff(int idleRounds)
+    {
+        if (idleRounds < SPIN_PAUSES) THREAD_SYSTEM_PAUSE();
+        else std::this_thread::yield(); //Oversubscribed machines need the core more than we need the latency.
+    }
+
+    inline std::uint32_t nextRandom(std::uint32_t& s)
+    {
+        s ^= s << 13; s ^= s >> 17; s ^= s << 5;
+        return s;
+    }
+}
+//--POOL-IDENTITY-END--
+
+ThreadSystem::ThreadSystem(int threads)
+{
+    const int hardware = (int)std::thread::hardware_concurrency();
+    n = std::max(1, threads > 0 ? threads : (hardware > 1 ? hardware - 1 : 1)); //Leave one core for OS/UI if possible.
+
+    deques.reset(new JobDeque[n + EXTERNAL_SLOTS]);
+    for (std::atomic<bool>& busy : externalBusy) busy.store(false, std::memory_order_relaxed);
+
+    workers.reserve(n);
+    for (int i = 0; i < n; ++i)
+    {
+        workers.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+ThreadSystem::~ThreadSystem()
+{
+    stop.store(true, std::memory_order_seq_cst); //Signal shutdown.
+    wakeEpoch.fetch_add(1, std::memory_order_seq_cst);
+    wakeEpoch.notify_all();                      //Wake all sleepers.
+
+    for (auto& t : workers) if (t.joinable()) t.join();
+}
+
+void ThreadSystem::runJob(const Job& job)
+{
+    ParallelTask& task = *job.task;
+    const int i0 = task.begin + (int)((int64_t)task.total * job.chunk / task.chunks);
+    const int i1 = task.begin + (int)((int64_t)task.total * (job.chunk + 1) / task.chunks);
+
+#if PROFILING
+    if (task.label)
+    {
+        PROFILE_CHUNK(task.label, task.group, job.chunk);
+        task.invoke(task.context, i0, i1, job.chunk); //User function receives range and chunk index.
+    }
+    else
+#endif
+    {
+        task.invoke(task.context, i0, i1, job.chunk); //Lanes: unlabelled, their stages record themselves.
+    }
+
+    task.remaining.fetch_sub(1, std::memory_order_acq_rel); //Last touch: the caller may return and free the task right after.
+}
+
+void ThreadSystem::run(ParallelTask& task)
+{
+    //--PICK-DEQUE-- (a worker pushes onto its own deque, anyone else borrows an external one)
+    int externalSlot = -1;
+    JobDeque* own = nullptr;
+
+    if (currentPool == this)
+    {
+        own = &deques[currentIndex];
+    }
+    else if ((externalSlot = acquireExternalSlot()) >= 0)
+    {
+        own = &deques[n + externalSlot];
+    }
+    //--PICK-DEQUE-END--
+
+    //--PUSH+WAKE-- (highest chunk first: the owner pops chunk 1 next to chunk 0, thieves take the far end)
+    for (int k = task.chunks - 1; k >= 1; --k)
+    {
+        const Job job{ &task, k };
+        if (!own || !own->push(job)) runJob(job); //No deque or ring full: run inline, still correct.
+    }
+
+    if (own) wake();
+    //--PUSH+WAKE-END--
+
+    runJob(Job{ &task, 0 });
+
+    //--HELP-UNTIL-DONE-- (the caller works instead of blocking; chunks of other calls are fair game too)
+    std::uint32_t seed = 0x9E3779B9u ^ static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(&task));
+    int idleRounds = 0;
+
+    while (task.remaining.load(std::memory_order_acquire) != 0)
+    {
+        Job job;
+        if (findJob(own, seed, job))
+        {
+            runJob(job);
+            idleRounds = 0;
+        }
+        else
+        {
+            backoff(idleRounds++); //Someone is still running a stolen chunk.
+        }
+    }
+    //--HELP-UNTIL-DONE-END--
+
+    if (externalSlot >= 0) externalBusy[externalSlot].store(false, std::memory_order_release);
+}
+
+bool ThreadSystem::helpOnce(int& idleRounds)
+{
+    thread_local std::uint32_t seed = 0x85EBCA6Bu;
+    JobDeque* own = currentPool == this ? &deques[currentIndex] : nullptr;
+
+    Job job;
+    if (findJob(own, seed, job))
+    {
+        runJob(job);
+        idleRounds = 0;
+        return true;
+    }
+
+    backoff(idleRounds++);
+    return false;
+}
+
+void ThreadSystem::workerLoop(int index)
+{
+    currentPool = this;
+    currentIndex = index;
+    PROFILE_THREAD_NAME("worker", index); //Trace lane per worker.
+
+    JobDeque* own = &deques[index];
+    std::uint32_t seed = 0x9E3779B9u * static_cast<std::uint32_t>(index + 1);
+    int idleRounds = 0;
+
+    for (;;)
+    {
+        Job job;
+        if (findJob(own, seed, job))
+        {
+            runJob(job);
+            idleRounds = 0;
+            continue;
+        }
+
+        if (stop.load(std::memory_order_acquire)) return;
+
+        if (idleRounds < SPIN_PAUSES + SPIN_YIELDS)
+        {
+            backoff(idleRounds++); //Substeps issue parallelFor calls microseconds apart, stay hot for the next one.
+            continue;
+        }
+
+        //--SLEEP-- (snapshot the epoch before announcing, so a push in between cannot be missed)
+        const std::uint32_t epoch = wakeEpoch.load(std::memory_order_seq_cst);
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+
+        if (!anyQueued() && !stop.load(std::memory_order_seq_cst)) wakeEpoch.wait(epoch, std::memory_order_seq_cst);
+
+        sleepers.fetch_sub(1, std::memory_order_seq_cst);
+        idleRounds = 0;
+        //--SLEEP-END--
+    }
+}
+
+bool ThreadSystem::findJob(JobDeque* own, std::uint32_t& seed, Job& job)
+{
+    if (own && own->pop(job)) return true;
+
+    const int count = n + EXTERNAL_SLOTS;
+    const int start = static_cast<int>(nextRandom(seed) % static_cast<std::uint32_t>(count)); //Random victim spreads thieves out.
+
+    for (int i = 0; i < count; ++i)
+    {
+        JobDeque* victim = &deques[(start + i) % count];
+        if (victim != own && victim->steal(job)) return true;
+    }
+
+    return false;
+}
+
+bool ThreadSystem::anyQueued() const
+{
+    for (int i = 0; i < n + EXTERNAL_SLOTS; ++i)
+    {
+        if (deques[i].maybeNonEmpty()) return true;
+    }
+
+    return false;
+}
+
+void ThreadSystem::wake()
+{
+    wakeEpoch.fetch_add(1, std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_seq_cst) > 0) wakeEpoch.notify_all();
+}
+
+int ThreadSystem::acquireExternalSlot()
+{
+    for (int i = 0; i < EXTERNAL_SLOTS; ++i)
+    {
+        bool expected = false;
+        if (externalBusy[i].compare_exchange_strong(expected, true, std::memory_order_acquire, std::memory_order_relaxed)) return i;
+    }
+
+    return -1;
+}
@@ -1,68 +1,43 @@
 /*
-    Small thread pool header: blocking parallelFor and job queue.
+    Work-stealing thread pool header: blocking parallelFor over per-thread Chase-Lev deques.
 */
 
 #pragma once
 
+#include "JobDeque.h"
+#include "../utils/Profiler.h"
+
 #include <thread>
 #include <vector>
-#include <queue>
-#include <functional>
-#include <mutex>
-#include <condition_variable>
+#include <memory>
 #include <atomic>
 #include <algorithm>
-
-//--SMALL-THREAD-POOL--
-//Tiny fixed-size thread pool with a blocking parallelFor. Keeps things simple and predictable.
+#include <type_traits>
+
+//--WORK-STEALING-POOL--
+//Fixed-size pool. parallelFor splits [begin,end) into at most getThreadCount() chunks, pushes them onto the
+//calling thread's deque, runs chunk 0 itself and then keeps popping and stealing until every chunk is done,
+//so the caller never sleeps on a condition variable. Idle workers steal from every deque, spin briefly and
+//then sleep on an epoch counter that each parallelFor bumps.
+//Jobs are (task pointer, chunk index) pairs in the deques, the callable stays on the caller's stack: nothing
+//is allocated per call or per chunk. Callers outside the pool borrow one of EXTERNAL_SLOTS deques; if all
+//are taken the call runs its chunks inline.
 class ThreadSystem
 {
 public:
-    explicit ThreadSystem(int threads = 0)
-    {
-        const int hardware = (int)std::thread::hardware_concurrency();
-        n = std::max(1, threads > 0 ? threads : (hardware > 1 ? hardware - 1 : 1)); //Leave one core for OS/UI if possible.
-
-        stop = false;
-        workers.reserve(n);
-
-        for (int i = 0; i < n; ++i)
-        {
-            workers.emplace_back([this]
-            {
-                for (;;)
-                {
-                    std::function<void()> job;
-                    {
-                        std::unique_lock<std::mutex> lock(mutex);
-
-                        conditionVariable.wait(lock, [this] { return stop || !q.empty(); }); //Sleep until work or shutdown.
-                        if (stop && q.empty()) return;
-
-                        job = std::move(q.front());
-                        q.pop();
-                    }
-
-                    job(); //Run job outside lock.
-                }
-            });
-        }
-    }
+    static constexpr int EXTERNAL_SLOTS = 4;    //Threads outside the pool that may call parallelFor at once.
 
-    ~ThreadSystem()
-    {
-        {
-            std::lock_guard<std::mutex> lk(mutex);
-            stop = true; //Signal shutdown.
-        }
+    explicit ThreadSystem(int threads = 0);
+    ~ThreadSystem();
 
-        conditionVariable.notify_all(); //Wake all workers.
-        for (auto& t : workers) if (t.joinable()) t.join();
-    }
+    ThreadSystem(const ThreadSystem&) = delete;
+    ThreadSystem& operator=(const ThreadSystem&) = delete;
 
-    int getThreadCount() const { return n; } //Current worker count.
+    int getThreadCount() const { return n; } //Current worker count (and the chunk count limit of parallelFor).
 
     //Blocking parallelFor that splits [begin,end) into 'chunks' and waits for completion.
+    //fn(i0, i1, k) gets a contiguous range and its chunk index k < getThreadCount(); chunk k's range comes
+    //before chunk k + 1's.
     template<typename Fn>
     void parallelFor(int begin, int end, int minGrain, Fn&& fn)
     {
@@ -70,49 +45,85 @@ public:
 
         if (total <= 0) return;
 
-        const int maxChunks = std::max(1, std::min(n, total / std::max(1, minGrain)));
-        const int chunks = std::max(1, maxChunks);
+        const int chunks = std::max(1, std::min(n, total / std::max(1, minGrain)));
 
-        struct Sync { std::atomic<int> remaining{ 0 }; std::mutex mutex; std::condition_variable conditionVariable; } sync;
-        sync.remaining.store(chunks, std::memory_order_relaxed);
-
-        for (int k = 0; k < chunks; ++k)
+        if (chunks == 1)
         {
-            const int i0 = begin + (int)((int64_t)total * k / chunks);
-            const int i1 = begin + (int)((int64_t)total * (k + 1) / chunks);
-
-            enqueue([i0, i1, k, &fn, &sync]
-            {
-                fn(i0, i1, k); //User function receives range and chunk index.
-
-                if (sync.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
-                {
-                    std::lock_guard<std::mutex> lk(sync.mutex);
-                    sync.conditionVariable.notify_one(); //If the last chunk is finished, wake waiter.
-                }
-            });
+            PROFILE_CHUNK(Profiler::currentScope(), Profiler::nextGroup(), 0);
+            fn(begin, end, 0); //Nothing to share, skip the deques entirely.
+            return;
         }
 
-        std::unique_lock<std::mutex> lock(sync.mutex);
-        sync.conditionVariable.wait(lock, [&sync] { return sync.remaining.load(std::memory_order_acquire) == 0; }); //Wait for all chunks.
+        using Callable = std::remove_reference_t<Fn>;
+
+        ParallelTask task;
+        task.invoke = [](void* context, int i0, int i1, int k) { (*static_cast<Callable*>(context))(i0, i1, k); };
+        task.context = const_cast<void*>(static_cast<const void*>(std::addressof(fn)));
+        task.begin = begin;
+        task.total = total;
+        task.chunks = chunks;
+        task.remaining.store(chunks, std::memory_order_relaxed);
+#if PROFILING
+        task.label = Profiler::currentScope();  //Chunks show up under the scope that issued them.
+        task.group = Profiler::nextGroup();     //One id per call, for the imbalance readout.
+#else
+        task.label = nullptr;
+        task.group = 0;
+#endif
+
+        run(task);
     }
 
-private:
-    void enqueue(std::function<void()> job)
+    //Runs fn(lane) for lane in [0, lanes), at most getThreadCount() + 1 lanes, and waits. Lane 0 runs on the
+    //calling thread, the others on workers; a caller without a free deque runs them all itself. Lanes are
+    //long-lived loops (TaskGraph), not chunks of work, so they are not recorded by the profiler.
+    template<typename Fn>
+    void parallelLanes(int lanes, Fn&& fn)
     {
+        const int chunks = std::max(1, std::min(lanes, n + 1));
+
+        if (chunks == 1)
         {
-            std::lock_guard<std::mutex> lk(mutex);
-            q.push(std::move(job));
+            fn(0);
+            return;
         }
 
-        conditionVariable.notify_one();
+        using Callable = std::remove_reference_t<Fn>;
+
+        ParallelTask task;
+        task.invoke = [](void* context, int, int, int k) { (*static_cast<Callable*>(context))(k); };
+        task.context = const_cast<void*>(static_cast<const void*>(std::addressof(fn)));
+        task.begin = 0;
+        task.total = chunks;
+        task.chunks = chunks;
+        task.remaining.store(chunks, std::memory_order_relaxed);
+        task.label = nullptr;
+        task.group = 0;
+
+        run(task);
     }
 
+    //Runs one queued chunk for any pending call if there is one, backs off otherwise. For threads that wait on
+    //something other than a parallelFor (TaskGraph lanes) but should not leave the pool's work to others.
+    bool helpOnce(int& idleRounds);
+
+private:
+    void run(ParallelTask& task);                                   //Push, wake, work and steal until task is done.
+    void workerLoop(int index);
+    bool findJob(JobDeque* own, std::uint32_t& seed, Job& job);     //Own bottom first, then steal round the pool.
+    bool anyQueued() const;
+    void wake();
+    int acquireExternalSlot();                                      //-1 when all are in use.
+
+    static void runJob(const Job& job);
+
     int n = 1;
     std::vector<std::thread> workers;
-    std::queue<std::function<void()>> q;
-    std::mutex mutex;
-    std::condition_variable conditionVariable;
-    bool stop = false;
+    std::unique_ptr<JobDeque[]> deques;                             //n worker deques, then EXTERNAL_SLOTS borrowed ones.
+    std::atomic<bool> externalBusy[EXTERNAL_SLOTS];
+
+    std::atomic<std::uint32_t> wakeEpoch{ 0 };                      //Bumped whenever work is pushed; sleepers wait on it.
+    std::atomic<int> sleepers{ 0 };                                 //Skip the notify syscall while everyone spins.
+    std::atomic<bool> stop{ false };
 };
-//--SMALL-THREAD-POOL-END--
\ No newline at end of file
+//--WORK-STEALING-POOL-END--
@@ -1,10 +1,12 @@
 /*
-    Uniform grid implementation: sparse reset, insert, and active cell tracking.
+    Uniform grid implementation: parallel counting-sort build into CSR buckets, active cell tracking.
 */
 
 #include "UniformGrid.h"
+#include "../scene/ParticleStore.h"
 
 #include <algorithm>
+#include <atomic>
 
 UniformGrid::UniformGrid(const glm::vec3& boxMin, const glm::vec3& boxMax, float cell)
 {
@@ -25,83 +27,217 @@ void UniformGrid::resize(const glm::vec3& boxMin, const glm::vec3& boxMax, float
 
     const int totalCells = gridDims.x * gridDims.y * gridDims.z;
     cellBucketLUT.assign(totalCells, -1); //-1 marks empty.
-    touchedCells.clear();                 //Touched list is empty after full resize.
+    cellCounts.assign(totalCells, 0);     //Histogram stays zero outside a build.
     activeCellLinear.clear();             //Linear list of active cell IDs (for fast iteration).
-    cellBuckets.clear();                  //Buckets will be created on demand.
-    usedBucketCount = 0;
-    nearWallIds.clear();                  //Reset the auxiliary near-wall list.
+    cellStart.assign(1, 0);               //Empty CSR.
+    cellObjects.clear();
+    colorCells.clear();
+    colorStart.clear();
 }
 
-void UniformGrid::clear(int expectedCount)
+void UniformGrid::build(ThreadSystem& tasks, const ParticleStore& particles, const std::vector<int>* subset)
 {
+    const int count = subset ? static_cast<int>(subset->size()) : particles.size();
+    const int MIN_GRAIN = 4096;
+
+    beginBuild(tasks, count, subset);
+
+    tasks.parallelFor(0, count, MIN_GRAIN, [&](int i0, int i1, int k)
+    {
+        binRange(particles, i0, i1, k);
+    });
+
+    finishBuild(tasks);
+}
+
+void UniformGrid::beginBuild(ThreadSystem& tasks, int count, const std::vector<int>* subset)
+{
+    const int chunkSlots = tasks.getThreadCount(); //parallelFor never splits into more chunks than workers.
+    const int MIN_GRAIN = 4096;
+
+    binCount = count;
+    binIds = subset ? subset->data() : nullptr; //Slot i holds object binIds[i] (or i when building everything).
+
     //--SPARSE-LUT-RESET--
-    for (int linearCellId : touchedCells) cellBucketLUT[linearCellId] = -1; //Only clear cells we touched last frame.
-    touchedCells.clear();
+    tasks.parallelFor(0, (int)activeCellLinear.size(), MIN_GRAIN, [&](int i0, int i1, int)
+    {
+        for (int i = i0; i < i1; ++i)
+        {
+            const int linearCellId = activeCellLinear[i];
+            cellBucketLUT[linearCellId] = -1; //Only clear cells we touched last build.
+            cellCounts[linearCellId] = 0;
+        }
+    });
     //--SPARSE-LUT-RESET-END--
 
-    activeCellLinear.clear();
-    nearWallIds.clear();
+    //--PER-BUILD-PREALLOC--
+    objectCell.resize(count);
+    objectRank.resize(count);
+    cellObjects.resize(count);
+    if ((int)chunkActive.size() != chunkSlots) chunkActive.resize(chunkSlots);
+    for (auto& list : chunkActive) list.clear();
+    //--PER-BUILD-PREALLOC-END--
+}
+
+void UniformGrid::binRange(const ParticleStore& particles, int i0, int i1, int k)
+{
+    const float* pX = particles.px.data();
+    const float* pY = particles.py.data();
+    const float* pZ = particles.pz.data();
+    const int* ids = binIds;
 
-    usedBucketCount = 0;
+    //--CELL-KEY+HISTOGRAM-- (one chunk of the parallel pass)
+    std::vector<int>& activated = chunkActive[k];
 
-    //--PER-FRAME-PREALLOC--
-    if (expectedCount > 0)
+    for (int i = i0; i < i1; ++i)
     {
-        const int capacityEstimate = std::min(expectedCount, gridDims.x * gridDims.y * gridDims.z);
+        const int id = ids ? ids[i] : i;
+        const float x = pX[id], y = pY[id], z = pZ[id];
 
-        if ((int)cellBuckets.size() < capacityEstimate) cellBuckets.resize(capacityEstimate); //Grow backing bucket store if needed.
-        if ((int)activeCellLinear.capacity() < capacityEstimate) activeCellLinear.reserve(capacityEstimate);
-        if ((int)touchedCells.capacity() < capacityEstimate) touchedCells.reserve(capacityEstimate);
+        //--INDEX-COMPUTE--
+        const int cellX = clampToRange(static_cast<int>(glm::floor((x - boxMin.x) * invCellSize)), 0, gridDims.x - 1);
+        const int cellY = clampToRange(static_cast<int>(glm::floor((y - boxMin.y) * invCellSize)), 0, gridDims.y - 1);
+        const int cellZ = clampToRange(static_cast<int>(glm::floor((z - boxMin.z) * invCellSize)), 0, gridDims.z - 1);
+        const int linearCellId = index(cellX, cellY, cellZ);
+        //--INDEX-COMPUTE-END--
 
-        const int nearWallReserve = std::max(32, expectedCount / 8);
+        const int rank = std::atomic_ref<int>(cellCounts[linearCellId]).fetch_add(1, std::memory_order_relaxed);
+        objectCell[i] = linearCellId;
+        objectRank[i] = rank;                           //Slot inside the cell, so the scatter needs no atomics.
 
-        if ((int)nearWallIds.capacity() < nearWallReserve) nearWallIds.reserve(nearWallReserve);
+        if (rank == 0) activated.push_back(linearCellId); //First object in a cell activates it (exactly once).
     }
-    //--PER-FRAME-PREALLOC-END--
+    //--CELL-KEY+HISTOGRAM-END--
 }
 
-void UniformGrid::insert(int objectId, const glm::vec3& position, float radius)
+void UniformGrid::finishBuild(ThreadSystem& tasks)
 {
-    //--INDEX-COMPUTE--
-    const glm::vec3 relative = (position - boxMin) * invCellSize; //Map to grid coordinates.
-    int cellX = static_cast<int>(glm::floor(relative.x));
-    int cellY = static_cast<int>(glm::floor(relative.y));
-    int cellZ = static_cast<int>(glm::floor(relative.z));
+    const int count = binCount;
+    const int* ids = binIds;
+    const int chunkSlots = tasks.getThreadCount();
+    const int MIN_GRAIN = 4096;
 
-    cellX = clampToRange(cellX, 0, gridDims.x - 1);
-    cellY = clampToRange(cellY, 0, gridDims.y - 1);
-    cellZ = clampToRange(cellZ, 0, gridDims.z - 1);
+    //--MERGE-CHUNK-LISTS--
+    chunkOffsets.assign(chunkSlots + 1, 0);
+    for (int k = 0; k < chunkSlots; ++k) chunkOffsets[k + 1] = chunkOffsets[k] + (int)chunkActive[k].size();
 
-    const int linearCellId = index(cellX, cellY, cellZ); //Linear cell index.
-    //--INDEX-COMPUTE-END--
+    activeCellLinear.resize(chunkOffsets[chunkSlots]);
 
-    int bucketIndex = cellBucketLUT[linearCellId];
-    if (bucketIndex < 0)
+    tasks.parallelFor(0, chunkSlots, 1, [&](int k0, int k1, int)
     {
-        bucketIndex = usedBucketCount++;
+        for (int k = k0; k < k1; ++k) std::copy(chunkActive[k].begin(), chunkActive[k].end(), activeCellLinear.begin() + chunkOffsets[k]);
+    });
+    //--MERGE-CHUNK-LISTS-END--
+
+    //--BUCKET-PREFIX-SUM-- (cell counts in activation order; each bucket also learns its LUT slot on the way)
+    const int activeCount = static_cast<int>(activeCellLinear.size());
+    cellStart.resize(activeCount + 1);
 
-        //--ENSURE-BUCKET-EXISTS--
-        if (bucketIndex >= (int)cellBuckets.size())
+    const int SCAN_GRAIN = 1024;
+    parallelScan(tasks, scanScratch, activeCount, SCAN_GRAIN, [&](int b)
+    {
+        const int linearCellId = activeCellLinear[b];
+        cellBucketLUT[linearCellId] = b;                //Map cell -> bucket index.
+        return cellCounts[linearCellId];
+    }, cellStart.data());
+    //--BUCKET-PREFIX-SUM-END--
+
+    //--SCATTER-- (parallel over objects, slots were reserved by the histogram)
+    tasks.parallelFor(0, count, MIN_GRAIN, [&](int i0, int i1, int)
+    {
+        for (int i = i0; i < i1; ++i)
         {
-            cellBuckets.resize(bucketIndex + 1);
+            cellObjects[cellStart[cellBucketLUT[objectCell[i]]] + objectRank[i]] = ids ? ids[i] : i;
         }
-        auto& bucket = cellBuckets[bucketIndex];
-        bucket.clear();                             //We reuse bucket storage across frames.
+    });
+    //--SCATTER-END--
 
-        if ((int)bucket.capacity() < 8) bucket.reserve(8);
-        //--ENSURE-BUCKET-EXISTS-END--
+    //--DETERMINISTIC-ORDER-- (canonical id order per bucket; buckets hold a handful of ids)
+    if (deterministic)
+    {
+        tasks.parallelFor(0, activeCount, SCAN_GRAIN, [&](int b0, int b1, int)
+        {
+            for (int b = b0; b < b1; ++b)
+            {
+                int* first = cellObjects.data() + cellStart[b];
+                int* last = cellObjects.data() + cellStart[b + 1];
+
+                for (int* it = first + 1; it < last; ++it) //Insertion sort: tiny spans, mostly sorted already.
+                {
+                    const int id = *it;
+                    int* hole = it;
+                    while (hole > first && hole[-1] > id) { *hole = hole[-1]; --hole; }
+                    *hole = id;
+                }
+            }
+        });
+    }
+    //--DETERMINISTIC-ORDER-END--
 
-        cellBucketLUT[linearCellId] = bucketIndex;  //Map cell -> bucket index.
-        touchedCells.push_back(linearCellId);       //Track to reset next frame.
-        activeCellLinear.push_back(linearCellId);   //Add to active cell list.
+    buildColorClasses();
+}
+
+void UniformGrid::buildColorClasses()
+{
+    //--COLOR-COUNTING-SORT--
+    int counts[CELL_COLOR_COUNT] = {};
+    const int activeCount = static_cast<int>(activeCellLinear.size());
+
+    for (int linearCellId : activeCellLinear)
+    {
+        int cellX, cellY, cellZ;
+        unpack(linearCellId, cellX, cellY, cellZ);
+        ++counts[cellColor(cellX, cellY, cellZ)];
     }
 
-    cellBuckets[bucketIndex].push_back(objectId);   //Store object index in this cell.
+    colorStart.assign(CELL_COLOR_COUNT + 1, 0);
+    for (int c = 0; c < CELL_COLOR_COUNT; ++c) colorStart[c + 1] = colorStart[c] + counts[c]; //Exclusive prefix sum.
+
+    int cursor[CELL_COLOR_COUNT];
+    for (int c = 0; c < CELL_COLOR_COUNT; ++c) cursor[c] = colorStart[c];
+
+    colorCells.resize(activeCount);
+    for (int linearCellId : activeCellLinear)
+    {
+        int cellX, cellY, cellZ;
+        unpack(linearCellId, cellX, cellY, cellZ);
+        colorCells[cursor[cellColor(cellX, cellY, cellZ)]++] = linearCellId; //Stable scatter keeps activation order per class.
+    }
+    //--COLOR-COUNTING-SORT-END--
+}
+
+float UniformGrid::measureIdSpread(ThreadSystem& tasks) const
+{
+    const int activeCount = static_cast<int>(activeCellLinear.size());
+    const int chunkSlots = tasks.getThreadCount();
+
+    std::vector<long long> strides(chunkSlots, 0);
+    std::vector<long long> gaps(chunkSlots, 0);
+
+    //--ID-SPREAD-REDUCTION--
+    tasks.parallelFor(0, activeCount, 1024, [&](int b0, int b1, int k)
+    {
+        long long stride = 0, gap = 0;
+
+        for (int b = b0; b < b1; ++b)
+        {
+            const CellSpan cell = bucket(b);
+            if (cell.count < 2) continue;
+
+            int lo = cell[0], hi = cell[0];
+            for (int id : cell) { lo = std::min(lo, id); hi = std::max(hi, id); }
+
+            stride += hi - lo;
+            gap += cell.count - 1;
+        }
+
+        strides[k] = stride;
+        gaps[k] = gap;
+    });
+    //--ID-SPREAD-REDUCTION-END--
+
+    long long stride = 0, gap = 0;
+    for (int k = 0; k < chunkSlots; ++k) { stride += strides[k]; gap += gaps[k]; }
 
-    //--NEAR-WALL-TRACK--
-    const bool nearX = (position.x - radius <= boxMin.x) || (position.x + radius >= boxMax.x);
-    const bool nearY = (position.y - radius <= boxMin.y) || (position.y + radius >= boxMax.y);
-    const bool nearZ = (position.z - radius <= boxMin.z) || (position.z + radius >= boxMax.z);
-    if (nearX || nearY || nearZ) nearWallIds.push_back(objectId); //Optional list for wall-optimized passes.
-    //--NEAR-WALL-TRACK-END--
+    return gap > 0 ? static_cast<float>(double(stride) / double(gap)) : 1.0f;
 }
\ No newline at end of file
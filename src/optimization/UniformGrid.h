@@ -5,11 +5,29 @@
 #pragma once
 
 #include "ThreadSystem.h"
+#include "ParallelScan.h"
 
 #include <glm.hpp>
 #include <vector>
 
-//Uniform grid broadphase. Sparse reset via "touched" keeps per-frame clear O(active).
+class ParticleStore;
+
+//--CELL-SPAN--
+//Read-only view of one CSR bucket (range of cellObjects). Iterates like the old per-cell vector.
+struct CellSpan
+{
+    const int* first = nullptr;
+    int count = 0;
+
+    const int* begin() const { return first; }
+    const int* end() const { return first + count; }
+    size_t size() const { return static_cast<size_t>(count); }
+    int operator[](int i) const { return first[i]; }
+};
+//--CELL-SPAN-END--
+
+//Uniform grid broadphase with flat CSR buckets. Built in parallel by counting sort; the active cell list
+//doubles as the "touched" list so the next build resets only O(active) cells.
 class UniformGrid
 {
 public:
@@ -17,9 +35,43 @@ public:
     UniformGrid(const glm::vec3& boxMin, const glm::vec3& boxMax, float cell);
 
     void resize(const glm::vec3& boxMin, const glm::vec3& boxMax, float cell); //Rebuild grid dims and storage.
-    void clear(int expectedCount);                                             //Sparse clear + opportunistic reserve.
+    //Parallel counting-sort build from the SoA streams. With a subset only those ids are binned (one size
+    //class of a HierarchicalGrid); objectCell/objectRank are then indexed by position in the subset.
+    void build(ThreadSystem& tasks, const ParticleStore& particles, const std::vector<int>* subset = nullptr);
+
+    //The same build in three steps, so the binning pass can ride along with another pass over the spheres
+    //(App integrates a chunk and bins it while it is still in cache). Between beginBuild and finishBuild,
+    //binRange must cover [0, count) exactly once, called from parallelFor chunks (k = chunk index; a chunk may
+    //bin its range in several ascending pieces).
+    void beginBuild(ThreadSystem& tasks, int count, const std::vector<int>* subset = nullptr); //Sparse reset, scratch.
+    void binRange(const ParticleStore& particles, int i0, int i1, int k);                      //Cell key + histogram.
+    void finishBuild(ThreadSystem& tasks);                                                     //Merge, prefix sum, scatter, colors.
+
+    //Deterministic mode: objects inside every bucket are sorted by id after the scatter, so pair order no
+    //longer depends on which thread won the histogram fetch_add. Bucket order may still vary, but cells of
+    //one color class never share spheres, so their relative order cannot change the result.
+    void setDeterministic(bool on) { deterministic = on; }
+    bool isDeterministic() const { return deterministic; }
+
+    int getActiveCellCount() const { return static_cast<int>(activeCellLinear.size()); }
+    int getActiveCell(int idx) const { return activeCellLinear[idx]; }
+    const glm::ivec3& getDims() const { return gridDims; }
+    void getCellCoords(int linearCellId, int& cellX, int& cellY, int& cellZ) const { unpack(linearCellId, cellX, cellY, cellZ); }
+
+    //Objects of one cell (empty span for inactive or out-of-range cells).
+    CellSpan getCellObjects(int cellX, int cellY, int cellZ) const
+    {
+        if (cellX < 0 || cellY < 0 || cellZ < 0 || cellX >= gridDims.x || cellY >= gridDims.y || cellZ >= gridDims.z) return CellSpan{ nullptr, 0 };
+        const int bucketIndex = cellBucketLUT[index(cellX, cellY, cellZ)];
+        return (bucketIndex < 0) ? CellSpan{ nullptr, 0 } : bucket(bucketIndex);
+    }
+    float getCellSize() const { return cellSize; }
+    const glm::vec3& getBoxMin() const { return boxMin; }
 
-    void insert(int objectId, const glm::vec3& position, float radius);        //Insert one element at position.
+    //Locality metric: id stride inside multi-object cells, sum(max id - min id) / sum(count - 1).
+    //Integer sums, so the value does not depend on how the reduction was chunked.
+    //~1 right after a spatial reorder, grows towards N/3 as ids scatter in space.
+    float measureIdSpread(ThreadSystem& tasks) const;
 
     //Enumerate potential pairs inside a cell and with its forward neighbors (no duplicates).
     template<typename Fn>
@@ -38,7 +90,7 @@ public:
             //--LOOKUP-ACTIVE-BUCKET--
             const int activeBucketIndex = cellBucketLUT[linearCellId];
             if (activeBucketIndex < 0) continue;
-            const auto& bucketA = cellBuckets[activeBucketIndex];
+            const auto& bucketA = bucket(activeBucketIndex);
             //--LOOKUP-ACTIVE-BUCKET-END--
 
             const int countA = static_cast<int>(bucketA.size());
@@ -78,7 +130,7 @@ public:
 
                         if (bucketIndex < 0) continue;
 
-                        const auto& bucketB = cellBuckets[bucketIndex];
+                        const auto& bucketB = bucket(bucketIndex);
 
                         for (int objectA : bucketA)
                         {
@@ -111,7 +163,7 @@ public:
 
                 const int activeBucketIndex = cellBucketLUT[linearCellId];
                 if (activeBucketIndex < 0) continue;
-                const auto& bucketA = cellBuckets[activeBucketIndex];
+                const auto& bucketA = bucket(activeBucketIndex);
 
                 const int countA = static_cast<int>(bucketA.size());
 
@@ -150,7 +202,7 @@ public:
 
                             if (bucketIndex < 0) continue;
 
-                            const auto& bucketB = cellBuckets[bucketIndex];
+                            const auto& bucketB = bucket(bucketIndex);
 
                             for (int objectA : bucketA)
                             {
@@ -178,155 +230,133 @@ public:
 
         tasks.parallelFor(0, activeCount, MIN_GRAIN, [&](int begin, int end, int)
         {
-            thread_local std::vector<int> bucketASorted;
-            thread_local std::vector<int> bucketBSorted;
-
-            auto sweepIntra = [&](const std::vector<int>& bucket)
+            for (int idx = begin; idx < end; ++idx)
             {
-                const int countInCell = (int)bucket.size();
+                visitCellPruned(activeCellLinear[idx], getPos, getRad, fn);
+            }
+        });
+    }
+    //--PRUNED-PAIR-ENUMERATION-END--
 
-                if (countInCell <= 64)
+    //--COLORED-PAIR-ENUMERATION--
+    //Lock-free variant: active cells are split into CELL_COLOR_COUNT classes and one class runs at a time.
+    //A cell visits itself plus its forward half-shell (x..x+1, y-1..y+1, z-1..z+1), so two cells of the same
+    //class (x mod 2, y mod 3, z mod 3) never touch a common cell and fn may mutate both objects without locks.
+    template<typename GetPos, typename GetRad, typename Fn>
+    void forEachPotentialPairColoredParallel(ThreadSystem& tasks, GetPos getPos, GetRad getRad, Fn&& fn) const
+    {
+        if (gridDims.x <= 0 || gridDims.y <= 0 || gridDims.z <= 0) return;
+        if (!hasColorClasses()) return; //buildColorClasses() not run for this build.
+
+        const int MIN_GRAIN = 16;
+
+        for (int color = 0; color < CELL_COLOR_COUNT; ++color)
+        {
+            tasks.parallelFor(colorStart[color], colorStart[color + 1], MIN_GRAIN, [&](int begin, int end, int)
+            {
+                for (int idx = begin; idx < end; ++idx)
                 {
-                    for (int i = 0; i < countInCell; ++i)
-                        for (int j = i + 1; j < countInCell; ++j)
-                            fn(bucket[i], bucket[j]); //Small cells: brute-force is cheaper.
+                    visitCellPruned(colorCells[idx], getPos, getRad, fn);
                 }
-                else
-                {
-                    bucketASorted.assign(bucket.begin(), bucket.end());
-                    std::sort(bucketASorted.begin(), bucketASorted.end(),
-                        [&](int idA, int idB) { return getPos(idA).x < getPos(idB).x; }); //Sort along X for a quick sweep.
+            }); //parallelFor blocks, which is the barrier between classes.
+        }
+    }
+    //--COLORED-PAIR-ENUMERATION-END--
 
-                    for (int i = 0; i < countInCell; ++i)
-                    {
-                        const int objectA = bucketASorted[i];
-                        const auto posA = getPos(objectA);
-                        const float radA = getRad(objectA);
+    static constexpr int CELL_COLOR_COUNT = 18;  //2 * 3 * 3 independent classes for the half-shell stencil.
+    void buildColorClasses();                    //Bucket active cells by color (call after the last insert).
 
-                        for (int j = i + 1; j < countInCell; ++j)
-                        {
-                            const int objectB = bucketASorted[j];
-                            if (getPos(objectB).x - posA.x > (radA + getRad(objectB))) break; //Stop when too far on X.
-                            fn(objectA, objectB);
-                        }
-                    }
-                }
-            };
+    bool hasColorClasses() const { return (int)colorStart.size() == CELL_COLOR_COUNT + 1; }
+    int getColorClassBegin(int color) const { return colorStart[color]; }
+    int getColorClassEnd(int color) const { return colorStart[color + 1]; }
+    int getColorCell(int idx) const { return colorCells[idx]; }
+    int getColorCount() const { return CELL_COLOR_COUNT; }
 
-            auto sweepCross = [&](const std::vector<int>& bucketA, const std::vector<int>& bucketB)
-            {
-                const int aCount = (int)bucketA.size(), bCount = (int)bucketB.size();
+    //Colored-source interface shared with HierarchicalGrid (ContactSolver::build): idx is a colorCells slot.
+    template<typename GetPos, typename GetRad, typename Fn>
+    void forEachPotentialPairInColorCell(int idx, GetPos& getPos, GetRad& getRad, Fn& fn) const
+    {
+        visitCellPruned(colorCells[idx], getPos, getRad, fn);
+    }
+
+    //Pruned pairs of one cell: intra-cell plus forward neighbors. Shared by the locked and colored enumerations.
+    template<typename GetPos, typename GetRad, typename Fn>
+    void forEachPotentialPairInCell(int linearCellId, GetPos& getPos, GetRad& getRad, Fn& fn) const
+    {
+        visitCellPruned(linearCellId, getPos, getRad, fn);
+    }
+
+    //Objects of one cell of this grid against the 3 x 3 x 3 cells around it in `other` (same box and cell size).
+    //Every pair once, as long as no object is in both grids.
+    template<typename GetPos, typename GetRad, typename Fn>
+    void forEachPotentialPairAcross(const UniformGrid& other, int linearCellId, GetPos& getPos, GetRad& getRad, Fn& fn) const
+    {
+        const int activeBucketIndex = cellBucketLUT[linearCellId];
+        if (activeBucketIndex < 0 || other.activeCellLinear.empty()) return;
+
+        int cellX, cellY, cellZ;
+        unpack(linearCellId, cellX, cellY, cellZ);
 
-                if (aCount == 0 || bCount == 0) return;
+        const CellSpan bucketA = bucket(activeBucketIndex);
 
-                if (aCount > 64 && bCount > 64)
+        for (int dz = -1; dz <= 1; ++dz)
+        {
+            for (int dy = -1; dy <= 1; ++dy)
+            {
+                for (int dx = -1; dx <= 1; ++dx)
                 {
-                    bucketASorted.assign(bucketA.begin(), bucketA.end());
-                    bucketBSorted.assign(bucketB.begin(), bucketB.end());
-                    std::sort(bucketASorted.begin(), bucketASorted.end(),
-                        [&](int idA, int idB) { return getPos(idA).x < getPos(idB).x; });
-                    std::sort(bucketBSorted.begin(), bucketBSorted.end(),
-                        [&](int idA, int idB) { return getPos(idA).x < getPos(idB).x; });
-
-                    int i = 0, j = 0;
-                    while (i < (int)bucketASorted.size() && j < (int)bucketBSorted.size())
+                    const int neighborX = cellX + dx, neighborY = cellY + dy, neighborZ = cellZ + dz;
+                    if (neighborX < 0 || neighborY < 0 || neighborZ < 0 ||
+                        neighborX >= gridDims.x || neighborY >= gridDims.y || neighborZ >= gridDims.z)
                     {
-                        const int objectA = bucketASorted[i]; const auto posA = getPos(objectA); const float radA = getRad(objectA);
-                        const int objectB = bucketBSorted[j]; const auto posB = getPos(objectB); const float radB = getRad(objectB);
+                        continue;
+                    }
 
-                        if (posA.x + radA < posB.x - radB) { ++i; continue; }
-                        if (posB.x + radB < posA.x - radA) { ++j; continue; }
+                    const int neighborBucketIndex = other.cellBucketLUT[index(neighborX, neighborY, neighborZ)];
+                    if (neighborBucketIndex < 0) continue;
+
+                    const CellSpan bucketB = other.bucket(neighborBucketIndex);
 
-                        int jj = j;
-                        while (jj < (int)bucketBSorted.size())
-                        {
-                            const int candidateB = bucketBSorted[jj];
-                            if (getPos(candidateB).x - posA.x > (radA + getRad(candidateB))) break;
-                            fn(objectA, candidateB);
-                            ++jj;
-                        }
-                        ++i;
-                    }
-                }
-                else
-                {
                     for (int objectA : bucketA)
                     {
                         const auto posA = getPos(objectA);
                         const float radA = getRad(objectA);
                         for (int objectB : bucketB)
                         {
-                            if (std::abs(getPos(objectB).x - posA.x) <= (radA + getRad(objectB)))
-                                fn(objectA, objectB); //Small buckets: simple check is enough.
-                        }
-                    }
-                }
-            };
-
-            for (int idx = begin; idx < end; ++idx)
-            {
-                const int linearCellId = activeCellLinear[idx];
-                const int activeBucketIndex = cellBucketLUT[linearCellId];
-                if (activeBucketIndex < 0) continue;
-
-                int cellX, cellY, cellZ;
-                unpack(linearCellId, cellX, cellY, cellZ);
-
-                const auto& bucketA = cellBuckets[activeBucketIndex];
-
-                sweepIntra(bucketA); //Intra-cell.
-
-                for (int dx = 0; dx <= 1; ++dx)
-                {
-                    for (int dy = -1; dy <= 1; ++dy)
-                    {
-                        for (int dz = -1; dz <= 1; ++dz)
-                        {
-                            if (dx == 0)
-                            {
-                                if (dy < 0) continue;
-                                if (dy == 0 && dz <= 0) continue;
-                            }
-
-                            const int neighborX = cellX + dx, neighborY = cellY + dy, neighborZ = cellZ + dz;
-                            if (neighborX < 0 || neighborY < 0 || neighborZ < 0 ||
-                                neighborX >= gridDims.x || neighborY >= gridDims.y || neighborZ >= gridDims.z)
-                            {
-                                continue;
-                            }
-
-                            const int neighborLinearCellId = index(neighborX, neighborY, neighborZ);
-                            const int neighborBucketIndex = cellBucketLUT[neighborLinearCellId];
-
-                            if (neighborBucketIndex < 0) continue;
-
-                            const auto& bucketB = cellBuckets[neighborBucketIndex];
-                            sweepCross(bucketA, bucketB); //Cross-cell.
+                            if (std::abs(getPos(objectB).x - posA.x) <= (radA + getRad(objectB))) fn(objectA, objectB);
                         }
                     }
                 }
             }
-        });
+        }
     }
-    //--PRUNED-PAIR-ENUMERATION-END--
-
-    const std::vector<int>& getNearWallList() const { return nearWallIds; } //Optional accessor.
 
 private:
     glm::vec3 boxMin{ 0.0f }, boxMax{ 0.0f };
     glm::ivec3 gridDims{ 0, 0, 0 };
     float cellSize = 1.0f;
     float invCellSize = 1.0f;
+    bool deterministic = false;
 
-    std::vector<int> activeCellLinear;           //Linear list of active cells (lids).
-    std::vector<std::vector<int>> cellBuckets;   //Bucket storage reused across frames.
+    std::vector<int> activeCellLinear;           //Active cells (lids); bucket index == position. Also the touched list.
+    std::vector<int> cellStart;                  //CSR offsets: bucket b owns cellObjects[cellStart[b], cellStart[b + 1]).
+    std::vector<int> cellObjects;                //Object ids grouped by cell.
     std::vector<int> cellBucketLUT;              //Cell -> bucket index (or -1).
-    std::vector<int> touchedCells;               //Cells to reset next frame.
-    int usedBucketCount = 0;
+    std::vector<int> cellCounts;                 //Dense per-cell counters (atomic_ref during build), zero between builds.
 
-    std::vector<int> nearWallIds;                //IDs near walls for wall-focused passes.
+    std::vector<int> objectCell;                 //Per-object cell id from the counting pass.
+    std::vector<int> objectRank;                 //Per-object slot inside its cell (from the histogram fetch_add).
+    std::vector<std::vector<int>> chunkActive;   //Per-chunk newly activated cells (merged into activeCellLinear).
+    std::vector<int> chunkOffsets;               //Scratch for the chunk list merge.
+    ParallelScratch scanScratch;                 //Bucket prefix sum.
+    int binCount = 0;                            //Objects of the build in progress.
+    const int* binIds = nullptr;                 //Subset of the build in progress (nullptr = all particles).
+
+    std::vector<int> colorCells;                 //Active cells grouped by color class.
+    std::vector<int> colorStart;                 //Class c owns colorCells[colorStart[c], colorStart[c + 1]).
 
     inline int clampToRange(int v, int lo, int hi) const { return v < lo ? lo : (v > hi ? hi : v); }
+    inline CellSpan bucket(int bucketIndex) const { return CellSpan{ cellObjects.data() + cellStart[bucketIndex], cellStart[bucketIndex + 1] - cellStart[bucketIndex] }; }
     inline int index(int cellX, int cellY, int cellZ) const { return (cellZ * gridDims.y + cellY) * gridDims.x + cellX; }
 
     inline void unpack(int linearCellId, int& cellX, int& cellY, int& cellZ) const
@@ -336,4 +366,160 @@ private:
         cellY = tmp % gridDims.y;
         cellZ = tmp / gridDims.y;
     }
-};
\ No newline at end of file
+
+    inline int cellColor(int cellX, int cellY, int cellZ) const { return (cellX % 2) + 2 * (cellY % 3) + 6 * (cellZ % 3); }
+
+    template<typename GetPos, typename GetRad, typename Fn>
+    void visitCellPruned(int linearCellId, GetPos& getPos, GetRad& getRad, Fn& fn) const
+    {
+        thread_local std::vector<int> bucketASorted;
+        thread_local std::vector<int> bucketBSorted;
+
+        auto sweepIntra = [&](const CellSpan& cellBucket)
+        {
+            const int countInCell = (int)cellBucket.size();
+
+            if (countInCell <= 64)
+            {
+                for (int i = 0; i < countInCell; ++i)
+                    for (int j = i + 1; j < countInCell; ++j)
+                        fn(cellBucket[i], cellBucket[j]); //Small cells: brute-force is cheaper.
+            }
+            else
+            {
+                bucketASorted.assign(cellBucket.begin(), cellBucket.end());
+                std::sort(bucketASorted.begin(), bucketASorted.end(),
+                    [&](int idA, int idB) { return getPos(idA).x < getPos(idB).x; }); //Sort along X for a quick sweep.
+
+                for (int i = 0; i < countInCell; ++i)
+                {
+                    const int objectA = bucketASorted[i];
+                    const auto posA = getPos(objectA);
+                    const float radA = getRad(objectA);
+
+                    for (int j = i + 1; j < countInCell; ++j)
+                    {
+                        const int objectB = bucketASorted[j];
+                        if (getPos(objectB).x - posA.x > (radA + getRad(objectB))) break; //Stop when too far on X.
+                        fn(objectA, objectB);
+                    }
+                }
+            }
+        };
+
+        auto sweepCross = [&](const CellSpan& bucketA, const CellSpan& bucketB)
+        {
+            const int aCount = (int)bucketA.size(), bCount = (int)bucketB.size();
+
+            if (aCount == 0 || bCount == 0) return;
+
+            if (aCount > 64 && bCount > 64)
+            {
+                bucketASorted.assign(bucketA.begin(), bucketA.end());
+                bucketBSorted.assign(bucketB.begin(), bucketB.end());
+                std::sort(bucketASorted.begin(), bucketASorted.end(),
+                    [&](int idA, int idB) { return getPos(idA).x < getPos(idB).x; });
+                std::sort(bucketBSorted.begin(), bucketBSorted.end(),
+                    [&](int idA, int idB) { return getPos(idA).x < getPos(idB).x; });
+
+                int i = 0, j = 0;
+                while (i < (int)bucketASorted.size() && j < (int)bucketBSorted.size())
+                {
+                    const int objectA = bucketASorted[i]; const auto posA = getPos(objectA); const float radA = getRad(objectA);
+                    const int objectB = bucketBSorted[j]; const auto posB = getPos(objectB); const float radB = getRad(objectB);
+
+                    if (posA.x + radA < posB.x - radB) { ++i; continue; }
+                    if (posB.x + radB < posA.x - radA) { ++j; continue; }
+
+                    int jj = j;
+                    while (jj < (int)bucketBSorted.size())
+                    {
+                        const int candidateB = bucketBSorted[jj];
+                        if (getPos(candidateB).x - posA.x > (radA + getRad(candidateB))) break;
+                        fn(objectA, candidateB);
+                        ++jj;
+                    }
+                    ++i;
+                }
+            }
+            else
+            {
+                for (int objectA : bucketA)
+                {
+                    const auto posA = getPos(objectA);
+                    const float radA = getRad(objectA);
+                    for (int objectB : bucketB)
+                    {
+                        if (std::abs(getPos(objectB).x - posA.x) <= (radA + getRad(objectB)))
+                            fn(objectA, objectB); //Small buckets: simple check is enough.
+                    }
+                }
+            }
+        };
+
+        const int activeBucketIndex = cellBucketLUT[linearCellId];
+        if (activeBucketIndex < 0) return;
+
+        int cellX, cellY, cellZ;
+        unpack(linearCellId, cellX, cellY, cellZ);
+
+        const auto& bucketA = bucket(activeBucketIndex);
+
+        sweepIntra(bucketA); //Intra-cell.
+
+        for (int dx = 0; dx <= 1; ++dx)
+        {
+            for (int dy = -1; dy <= 1; ++dy)
+            {
+                for (int dz = -1; dz <= 1; ++dz)
+                {
+                    if (dx == 0)
+                    {
+                        if (dy < 0) continue;
+                        if (dy == 0 && dz <= 0) continue;
+                    }
+
+                    const int neighborX = cellX + dx, neighborY = cellY + dy, neighborZ = cellZ + dz;
+                    if (neighborX < 0 || neighborY < 0 || neighborZ < 0 ||
+                        neighborX >= gridDims.x || neighborY >= gridDims.y || neighborZ >= gridDims.z)
+                    {
+                        continue;
+                    }
+
+                    const int neighborLinearCellId = index(neighborX, neighborY, neighborZ);
+                    const int neighborBucketIndex = cellBucketLUT[neighborLinearCellId];
+
+                    if (neighborBucketIndex < 0) continue;
+
+                    const auto& bucketB = bucket(neighborBucketIndex);
+                    sweepCross(bucketA, bucketB); //Cross-cell.
+                }
+            }
+        }
+    }
+};
+
+//--LAYERED-GRID-PAIRS--
+//Colored pair source for ContactSolver::build over two grids of one geometry: `moving` is rebuilt every substep
+//from a subset (the awake spheres), `resting` holds the rest and is rebuilt only when that set changes. Pairs are
+//the usual ones inside `moving` plus every moving object against the resting cells around it; two resting
+//objects are never paired. A resting object may be visited from cells of one color class on different threads,
+//so the consumer must treat it as read-only.
+struct LayeredGridPairs
+{
+    const UniformGrid& moving;
+    const UniformGrid& resting;
+
+    int getColorCount() const { return moving.getColorCount(); }
+    bool hasColorClasses() const { return moving.hasColorClasses(); }
+    int getColorClassBegin(int color) const { return moving.getColorClassBegin(color); }
+    int getColorClassEnd(int color) const { return moving.getColorClassEnd(color); }
+
+    template<typename GetPos, typename GetRad, typename Fn>
+    void forEachPotentialPairInColorCell(int idx, GetPos& getPos, GetRad& getRad, Fn& fn) const
+    {
+        moving.forEachPotentialPairInColorCell(idx, getPos, getRad, fn);
+        moving.forEachPotentialPairAcross(resting, moving.getColorCell(idx), getPos, getRad, fn);
+    }
+};
+//--LAYERED-GRID-PAIRS-END--
\ No newline at end of file
@@ -24,6 +24,9 @@ public:
     void draw() const; //Draw wireframe box.
     void resolveCollision(Sphere& s, float restitution) const; //Clamp position and invert velocity.
 
+    const glm::vec3& getMin() const { return min; }
+    const glm::vec3& getMax() const { return max; }
+
 private:
     GLuint vertexArray{ 0 }, vertexBuffer{ 0 }, elementBuffer{ 0 };
     glm::vec3 min{ 0.0f, 0.0f, 0.0f };
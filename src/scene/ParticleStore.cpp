@@ -0,0 +1,151 @@
+/*
+    Particle store implementation: SoA append, Euler integration, and sphere-sphere resolve.
+*/
+
+#include "ParticleStore.h"
+#include "Sphere.h"
+
+#include <cmath>
+#include <algorithm>
+
+void ParticleStore::reserve(int capacity)
+{
+    const size_t n = static_cast<size_t>(std::max(0, capacity));
+
+    px.reserve(n); py.reserve(n); pz.reserve(n);
+    vx.reserve(n); vy.reserve(n); vz.reserve(n);
+    radius.reserve(n);
+    invMass.reserve(n);
+    awake.reserve(n);
+    color.reserve(n);
+    sleepTimer.reserve(n);
+    restX.reserve(n); restY.reserve(n); restZ.reserve(n);
+}
+
+void ParticleStore::resize(int newCount)
+{
+    const size_t n = static_cast<size_t>(std::max(0, newCount));
+
+    px.resize(n); py.resize(n); pz.resize(n);
+    vx.resize(n); vy.resize(n); vz.resize(n);
+    radius.resize(n);
+    invMass.resize(n);
+    awake.resize(n);
+    color.resize(n);
+    sleepTimer.resize(n);
+    restX.resize(n); restY.resize(n); restZ.resize(n);
+    count = static_cast<int>(n);
+}
+
+void ParticleStore::swap(ParticleStore& other) noexcept
+{
+    px.swap(other.px); py.swap(other.py); pz.swap(other.pz);
+    vx.swap(other.vx); vy.swap(other.vy); vz.swap(other.vz);
+    radius.swap(other.radius);
+    invMass.swap(other.invMass);
+    awake.swap(other.awake);
+    color.swap(other.color);
+    sleepTimer.swap(other.sleepTimer);
+    restX.swap(other.restX); restY.swap(other.restY); restZ.swap(other.restZ);
+    std::swap(count, other.count);
+}
+
+void ParticleStore::gather(const ParticleStore& src, const int* newToOld, int begin, int end)
+{
+    for (int i = begin; i < end; ++i)
+    {
+        const int o = newToOld[i];
+        px[i] = src.px[o]; py[i] = src.py[o]; pz[i] = src.pz[o];
+        vx[i] = src.vx[o]; vy[i] = src.vy[o]; vz[i] = src.vz[o];
+        radius[i] = src.radius[o];
+        invMass[i] = src.invMass[o];
+        awake[i] = src.awake[o];
+        color[i] = src.color[o];
+        sleepTimer[i] = src.sleepTimer[o];
+        restX[i] = src.restX[o]; restY[i] = src.restY[o]; restZ[i] = src.restZ[o];
+    }
+}
+
+void ParticleStore::clear()
+{
+    px.clear(); py.clear(); pz.clear();
+    vx.clear(); vy.clear(); vz.clear();
+    radius.clear();
+    invMass.clear();
+    awake.clear();
+    color.clear();
+    sleepTimer.clear();
+    restX.clear(); restY.clear(); restZ.clear();
+    count = 0;
+}
+
+int ParticleStore::add(const glm::vec3& position, float r)
+{
+    const int id = count++;
+
+    px.push_back(position.x); py.push_back(position.y); pz.push_back(position.z);
+    vx.push_back(0.0f); vy.push_back(0.0f); vz.push_back(0.0f);
+    radius.push_back(r);
+    invMass.push_back(1.0f / (r * r * r));
+    awake.push_back(1.0f);
+    sleepTimer.push_back(0.0f);
+    restX.push_back(position.x); restY.push_back(position.y); restZ.push_back(position.z);
+
+    //--COLORING--
+    uint32_t seed = colorRNG::seedFromIndex(static_cast<uint32_t>(id)); //Per-particle seed from the id, matches Sphere.
+    const uint32_t cr = static_cast<uint32_t>((0.1f + 0.9f * colorRNG::u01(colorRNG::xs32(seed))) * 255.0f + 0.5f);
+    const uint32_t cg = static_cast<uint32_t>((0.1f + 0.9f * colorRNG::u01(colorRNG::xs32(seed))) * 255.0f + 0.5f);
+    const uint32_t cb = static_cast<uint32_t>((0.1f + 0.9f * colorRNG::u01(colorRNG::xs32(seed))) * 255.0f + 0.5f);
+    color.push_back(cr | (cg << 8) | (cb << 16) | (255u << 24)); //Packed once here instead of every upload.
+    //--COLORING-END--
+
+    return id;
+}
+
+void ParticleStore::collide(int a, int b, float restitution)
+{
+    const glm::vec3 d(px[a] - px[b], py[a] - py[b], pz[a] - pz[b]);
+    const float d2 = glm::dot(d, d);
+    const float r = radius[a] + radius[b];
+
+    if (d2 >= r * r) return; //No overlap.
+
+    const float distance = std::sqrt(std::max(d2, 1e-8f));
+    const glm::vec3 n = (distance > 1e-6f) ? (d / distance) : glm::vec3(1.0f, 0.0f, 0.0f); //Fallback axis if overlapping too much.
+
+    const float invA = invMass[a];
+    const float invB = invMass[b];
+    const float invSum = invA + invB;
+
+    const float penetration = r - distance;
+
+    //Keeps the method from overcorrecting and reduces jitter for tiny overlaps.
+    const float percent = 0.8f; //Positional correction to resolve interpenetration.
+    const float slop = 0.001f;
+
+    const glm::vec3 correction = ((std::max(penetration - slop, 0.0f) / invSum) * percent) * n;
+    px[a] += correction.x * invA; py[a] += correction.y * invA; pz[a] += correction.z * invA;
+    px[b] -= correction.x * invB; py[b] -= correction.y * invB; pz[b] -= correction.z * invB;
+
+    const glm::vec3 relativeVelocity(vx[a] - vx[b], vy[a] - vy[b], vz[a] - vz[b]);
+    const float velocityAlongNormal = glm::dot(relativeVelocity, n);
+    if (velocityAlongNormal > 0.0f) return; //Currently separating, nothing to do.
+
+    const float j = -(1.0f + restitution) * velocityAlongNormal / invSum;
+
+    glm::vec3 impulse = j * n;
+
+    //--TINY-TANGENTIAL-FRICTION--
+    const float mu = 0.02f;
+    const glm::vec3 t = relativeVelocity - n * velocityAlongNormal; //Tangential relative velocity.
+    const float t2 = glm::dot(t, t);
+
+    if (t2 > 1e-12f)
+    {
+        impulse += (-mu * j / std::sqrt(t2)) * t; //Very small friction to damp sliding.
+    }
+    //--TINY-TANGENTIAL-FRICTION-END--
+
+    vx[a] += impulse.x * invA; vy[a] += impulse.y * invA; vz[a] += impulse.z * invA;
+    vx[b] -= impulse.x * invB; vy[b] -= impulse.y * invB; vz[b] -= impulse.z * invB;
+}
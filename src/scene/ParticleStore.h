@@ -0,0 +1,92 @@
+/*
+    Particle store header: Structure-of-Arrays sphere state for the physics and render hot paths.
+*/
+
+#pragma once
+
+#include <glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <new>
+
+//--ALIGNED-ALLOCATOR--
+//Cache-line aligned allocator so every SoA stream starts on a 64-byte boundary (SIMD-friendly loads).
+template<typename T, std::size_t Alignment = 64>
+struct AlignedAllocator
+{
+    using value_type = T;
+
+    template<typename U> struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+    AlignedAllocator() noexcept = default;
+    template<typename U> AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T* p, std::size_t) noexcept
+    {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    template<typename U> bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+    template<typename U> bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+};
+
+using AlignedFloats = std::vector<float, AlignedAllocator<float>>;
+//--ALIGNED-ALLOCATOR-END--
+
+//SoA sphere storage. Hot streams (position, velocity, radius, inverse mass) are split per component
+//so each stage only pulls the bytes it reads. Color is cold and already packed for instance upload.
+class ParticleStore
+{
+public:
+    ParticleStore() = default;
+
+    ParticleStore(const ParticleStore&) = delete;
+    ParticleStore& operator=(const ParticleStore&) = delete;
+
+    void reserve(int capacity);                                 //Reserve every stream at once.
+    void resize(int newCount);                                  //Resize every stream (new entries are zeroed).
+    void clear();                                               //Drop all particles, keep capacity.
+    void swap(ParticleStore& other) noexcept;                   //O(1) exchange of all streams.
+
+    //this[i] = src[newToOld[i]] for i in [begin,end). Every stream, hot and cold, is permuted together.
+    void gather(const ParticleStore& src, const int* newToOld, int begin, int end);
+
+    int add(const glm::vec3& position, float radius);           //Append one sphere at rest, returns its id.
+    int size() const { return count; }
+
+    glm::vec3 getPosition(int i) const { return glm::vec3(px[i], py[i], pz[i]); }
+    glm::vec3 getVelocity(int i) const { return glm::vec3(vx[i], vy[i], vz[i]); }
+    float getRadius(int i) const { return radius[i]; }
+    float getInvMass(int i) const { return invMass[i]; }
+    std::uint32_t getColorPacked(int i) const { return color[i]; }
+
+    void setPosition(int i, const glm::vec3& p) { px[i] = p.x; py[i] = p.y; pz[i] = p.z; }
+    void setVelocity(int i, const glm::vec3& v) { vx[i] = v.x; vy[i] = v.y; vz[i] = v.z; }
+    void setRadius(int i, float r) { radius[i] = r; invMass[i] = 1.0f / (r * r * r); } //Mass from volume for same density.
+    bool isAwake(int i) const { return awake[i] != 0.0f; }
+
+    void collide(int a, int b, float restitution);                               //Sphere-sphere resolve (positional + impulse).
+
+    //--HOT-STREAMS--
+    AlignedFloats px, py, pz;       //Positions.
+    AlignedFloats vx, vy, vz;       //Velocities.
+    AlignedFloats radius;           //Radii.
+    AlignedFloats invMass;          //1 / mass, precomputed so the solver never divides by mass.
+    AlignedFloats awake;            //1 = simulated, 0 = sleeping (not integrated, no inverse mass in the solver).
+    //--HOT-STREAMS-END--
+
+    //--COLD-STREAMS--
+    std::vector<std::uint32_t> color; //UNORM8 RGBA (R in the low byte), ready to copy into the instance stream.
+    AlignedFloats sleepTimer;         //Seconds the sphere stayed near its rest anchor.
+    AlignedFloats restX, restY, restZ;//Rest anchor: position where the current rest window started.
+    //--COLD-STREAMS-END--
+
+private:
+    int count = 0;
+};
@@ -0,0 +1,95 @@
+/*
+    Render snapshot implementation: parallel stream copy on publish, buffer swap on flip.
+*/
+
+#include "RenderSnapshot.h"
+#include "../optimization/ThreadSystem.h"
+
+#include <algorithm>
+
+void RenderSnapshot::capturePrevious(ThreadSystem& tasks, const ParticleStore& particles)
+{
+    const size_t size = static_cast<size_t>(particles.size());
+    capturedX.resize(size); capturedY.resize(size); capturedZ.resize(size);
+
+    tasks.parallelFor(0, particles.size(), 8192, [&](int i0, int i1, int)
+    {
+        std::copy(particles.px.begin() + i0, particles.px.begin() + i1, capturedX.begin() + i0);
+        std::copy(particles.py.begin() + i0, particles.py.begin() + i1, capturedY.begin() + i0);
+        std::copy(particles.pz.begin() + i0, particles.pz.begin() + i1, capturedZ.begin() + i0);
+    });
+
+    captured = true;
+}
+
+void RenderSnapshot::publish(ThreadSystem& tasks, const ParticleStore& particles, const std::vector<int>* oldToNew)
+{
+    RenderState& back = states[1 - frontIndex];
+    const int n = particles.size();
+
+    if (back.count != n)
+    {
+        const size_t size = static_cast<size_t>(n);
+        back.px.resize(size); back.py.resize(size); back.pz.resize(size);
+        back.prevX.resize(size); back.prevY.resize(size); back.prevZ.resize(size);
+        back.radius.resize(size);
+        back.color.resize(size);
+        back.blocks.resize(static_cast<size_t>((n + 63) >> 6));
+        back.count = n;
+    }
+
+    const bool blend = captured && (int)capturedX.size() == n;
+
+    tasks.parallelFor(0, n, 8192, [&](int i0, int i1, int)
+    {
+        std::copy(particles.px.begin() + i0, particles.px.begin() + i1, back.px.begin() + i0);
+        std::copy(particles.py.begin() + i0, particles.py.begin() + i1, back.py.begin() + i0);
+        std::copy(particles.pz.begin() + i0, particles.pz.begin() + i1, back.pz.begin() + i0);
+        std::copy(particles.radius.begin() + i0, particles.radius.begin() + i1, back.radius.begin() + i0); //Radius and color follow reorders.
+        std::copy(particles.color.begin() + i0, particles.color.begin() + i1, back.color.begin() + i0);
+
+        if (!blend)
+        {
+            std::copy(particles.px.begin() + i0, particles.px.begin() + i1, back.prevX.begin() + i0);
+            std::copy(particles.py.begin() + i0, particles.py.begin() + i1, back.prevY.begin() + i0);
+            std::copy(particles.pz.begin() + i0, particles.pz.begin() + i1, back.prevZ.begin() + i0);
+        }
+        else if (oldToNew)
+        {
+            for (int i = i0; i < i1; ++i) //Scatter: a permutation, so chunks never write the same slot.
+            {
+                const int j = (*oldToNew)[i];
+                back.prevX[j] = capturedX[i];
+                back.prevY[j] = capturedY[i];
+                back.prevZ[j] = capturedZ[i];
+            }
+        }
+        else
+        {
+            std::copy(capturedX.begin() + i0, capturedX.begin() + i1, back.prevX.begin() + i0);
+            std::copy(capturedY.begin() + i0, capturedY.begin() + i1, back.prevY.begin() + i0);
+            std::copy(capturedZ.begin() + i0, capturedZ.begin() + i1, back.prevZ.begin() + i0);
+        }
+    });
+
+    //Block bounds need both position sets complete (the scatter above writes across chunks), hence a second pass.
+    const CullStreams spheres = back.cullStreams();
+    tasks.parallelFor(0, (int)back.blocks.size(), 64, [&](int w0, int w1, int)
+    {
+        computeCullBlocks(spheres, w0 << 6, std::min(n, w1 << 6), back.blocks.data(), simdLevel);
+    });
+
+    captured = false;
+    published = true;
+}
+
+void RenderSnapshot::flip()
+{
+    if (published) //No substep this frame: the front state is still the latest, only alpha moves on.
+    {
+        frontIndex = 1 - frontIndex;
+        published = false;
+    }
+
+    states[frontIndex].alpha = pendingAlpha;
+}
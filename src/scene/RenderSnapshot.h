@@ -0,0 +1,76 @@
+/*
+    Render snapshot header: double-buffered copy of the particle streams that culling and instance upload read.
+*/
+
+#pragma once
+
+#include "ParticleStore.h"
+#include "../optimization/SimdCulling.h"
+
+#include <glm.hpp>
+#include <vector>
+#include <cstdint>
+
+class ThreadSystem;
+
+//The streams a frame draws from, laid out like ParticleStore so cull and pack loops read the same names.
+//Positions are the last two physics steps, getPosition() blends them by alpha (leftover accumulator / dt),
+//so the picture moves every frame even when the frame rate is above the step rate.
+struct RenderState
+{
+    AlignedFloats px, py, pz;       //Positions after the last step.
+    AlignedFloats prevX, prevY, prevZ; //Positions before it, same ids.
+    AlignedFloats radius;           //Radii.
+    std::vector<std::uint32_t> color; //UNORM8 RGBA, as in ParticleStore.
+    int count = 0;
+    float alpha = 1.0f;             //Blend weight of px over prevX, set by flip().
+    std::vector<CullBlock> blocks;  //Bounds per 64 ids, built on publish for the block-level cull.
+
+    glm::vec3 getPosition(int i) const
+    {
+        const float keep = 1.0f - alpha; //Two-weight form: exact at alpha 0 and 1.
+        return glm::vec3(prevX[i] * keep + px[i] * alpha,
+                         prevY[i] * keep + py[i] * alpha,
+                         prevZ[i] * keep + pz[i] * alpha);
+    }
+
+    CullStreams cullStreams() const //The same blend, for the batched cull kernels.
+    {
+        CullStreams s;
+        s.x = px.data(); s.y = py.data(); s.z = pz.data();
+        s.r = radius.data();
+        s.prevX = prevX.data(); s.prevY = prevY.data(); s.prevZ = prevZ.data();
+        s.alpha = alpha;
+        return s;
+    }
+};
+
+//Physics publishes into the back state at the end of a frame's substeps while culling and packing read the
+//front one, so the render stages never wait on the solver. flip() runs at the frame boundary, after both
+//sides are done (TaskGraph::run returned), which is why two states are enough: nobody holds the front one
+//across frames. Ids are snapshot-local: a spatial reorder in the pipeline reaches the renderer with the
+//next publish, together with the positions.
+class RenderSnapshot
+{
+public:
+    void capturePrevious(ThreadSystem& tasks, const ParticleStore& particles); //Right before the frame's last step.
+
+    //Writer side, one call per frame at most. oldToNew: permutation done by the last step (nullptr if none),
+    //applied to the captured positions. Without a capture the state starts at rest (prev = current).
+    void publish(ThreadSystem& tasks, const ParticleStore& particles, const std::vector<int>* oldToNew);
+
+    void setAlpha(float alpha) { pendingAlpha = alpha; }  //For the next flip, even without a publish.
+    void flip();                                           //Front = last publish, if there was one.
+
+    const RenderState& front() const { return states[frontIndex]; }
+
+    SimdLevel simdLevel = detectSimdLevel(); //For the block bounds built on publish.
+
+private:
+    RenderState states[2];
+    AlignedFloats capturedX, capturedY, capturedZ;         //Pre-step positions, pre-permutation ids.
+    int frontIndex = 0;
+    bool captured = false;
+    bool published = false;                                //Back holds a publish the front has not seen yet.
+    float pendingAlpha = 1.0f;
+};
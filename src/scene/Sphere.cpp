@@ -9,10 +9,10 @@
 #include <cmath>
 #include <algorithm>
 
-Sphere::Sphere(unsigned XSegments, unsigned YSegments, const glm::vec3& getPosition, float getScale) : position(getPosition), scale(getScale)
+Sphere::Sphere(unsigned XSegments, unsigned YSegments, const glm::vec3& getPosition, float getScale, uint32_t index) : position(getPosition), scale(getScale)
 {
     //--COLORING--
-    uint32_t seed = 0x9E3779B9u ^ (uint32_t)(uintptr_t)this; //Per-instance seed using pointer bits.
+    uint32_t seed = colorRNG::seedFromIndex(index); //Index, not pointer bits: colors reproduce across runs.
     float r = 0.1f + 0.9f * colorRNG::u01(colorRNG::xs32(seed));
     float g = 0.1f + 0.9f * colorRNG::u01(colorRNG::xs32(seed));
     float b = 0.1f + 0.9f * colorRNG::u01(colorRNG::xs32(seed));
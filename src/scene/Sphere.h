@@ -12,6 +12,7 @@ namespace colorRNG
 {
     inline uint32_t xs32(uint32_t& s) { s ^= s << 13; s ^= s >> 17; s ^= s << 5; return s; }
     inline float u01(uint32_t v) { return (float)((v >> 8) * (1.0 / 16777215.0)); } //24-bit to [0,1)
+    inline uint32_t seedFromIndex(uint32_t index) { return 0x9E3779B9u ^ (index * 0x85EBCA6Bu); } //Same seed for the same id on every run.
 }
 //--COLOR-RNG-END--
 
@@ -19,8 +20,8 @@ namespace colorRNG
 class Sphere
 {
 public:
-    //XSegments = longitude, YSegments = latitude.
-    Sphere(unsigned XSegments = 24, unsigned YSegments = 24, const glm::vec3& getPosition = glm::vec3(0.0f), float getScale = 0.25f);
+    //XSegments = longitude, YSegments = latitude. Index seeds the color (same index, same color).
+    Sphere(unsigned XSegments = 24, unsigned YSegments = 24, const glm::vec3& getPosition = glm::vec3(0.0f), float getScale = 0.25f, uint32_t index = 0);
 
     Sphere(const Sphere&) = delete;
     Sphere& operator=(const Sphere&) = delete;
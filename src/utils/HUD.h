@@ -62,9 +62,29 @@ public:
     }
 
     void draw(int screenW, int screenH, const char* line1, const char* line2, const char* line3)
+    {
+        const char* lines[3] = { line1, line2, line3 };
+        const glm::vec3 colors[3] = { glm::vec3(1.0f), glm::vec3(0.85f, 0.92f, 1.0f), glm::vec3(0.85f, 1.0f, 0.85f) };
+        drawLines(screenW, screenH, lines, colors, 3);
+    }
+
+    //Draw any number of lines: the first white, the last green, the ones between blue.
+    void draw(int screenW, int screenH, const char* const* lines, int lineCount)
+    {
+        std::vector<glm::vec3> colors(lineCount, glm::vec3(0.85f, 0.92f, 1.0f));
+        if (lineCount > 1) colors.back() = glm::vec3(0.85f, 1.0f, 0.85f);
+        if (lineCount > 0) colors.front() = glm::vec3(1.0f);
+        drawLines(screenW, screenH, lines, colors.data(), lineCount);
+    }
+
+private:
+    struct HUDRect { float x, y, w, h; float r, g, b, a; };
+
+    //Null or empty lines are skipped.
+    void drawLines(int screenW, int screenH, const char* const* lines, const glm::vec3* colors, int lineCount)
     {
         std::vector<HUDRect> rects;
-        rects.reserve(2048); //Enough for a few dozen characters.
+        rects.reserve(4096); //Enough for a few lines of text.
 
         //--HUD-MEASURE--
         const int scale = 2;            //Text size.
@@ -91,17 +111,17 @@ public:
             return total;
         };
 
-        const int w1 = measure(line1);
-        const int w2 = measure(line2);
-        const int w3 = measure(line3);
-        const int bw = (std::max)((std::max)(w1, w2), w3) + pad * 2;
+        int widest = 0;
+        int shown = 0;
 
-        int lines = 0; 
-        if (line1 && *line1) ++lines; 
-        if (line2 && *line2) ++lines; 
-        if (line3 && *line3) ++lines;
+        for (int k = 0; k < lineCount; ++k)
+        {
+            widest = (std::max)(widest, measure(lines[k]));
+            if (lines[k] && *lines[k]) ++shown;
+        }
 
-        const int bh = (lines ? (7 * scale * lines + lineGap * (lines - 1)) : 0) + pad * 2;
+        const int bw = widest + pad * 2;
+        const int bh = (shown ? (7 * scale * shown + lineGap * (shown - 1)) : 0) + pad * 2;
         //--HUD-MEASURE-END--
 
         //--HUD-BUILD-RECTS--
@@ -111,9 +131,13 @@ public:
 
         //Text lines.
         int ty = y0 + pad;
-        if (line1 && *line1) { appendText(rects, x0 + pad, ty, scale, charSpacing, line1, 1, 1, 1, 1); ty += 7 * scale + lineGap; }
-        if (line2 && *line2) { appendText(rects, x0 + pad, ty, scale, charSpacing, line2, 0.85f, 0.92f, 1.0f, 1); ty += 7 * scale + lineGap; }
-        if (line3 && *line3) { appendText(rects, x0 + pad, ty, scale, charSpacing, line3, 0.85f, 1.0f, 0.85f, 1); }
+        for (int k = 0; k < lineCount; ++k)
+        {
+            if (!lines[k] || !*lines[k]) continue;
+
+            appendText(rects, x0 + pad, ty, scale, charSpacing, lines[k], colors[k].r, colors[k].g, colors[k].b, 1);
+            ty += 7 * scale + lineGap;
+        }
         //--HUD-BUILD-RECTS-END--
 
         //--HUD-UPLOAD+DRAW--
@@ -141,9 +165,6 @@ public:
         //--HUD-UPLOAD+DRAW-END--
     }
 
-private:
-    struct HUDRect { float x, y, w, h; float r, g, b, a; };
-
     struct Glyph { uint8_t row[7]; uint8_t advance; }; //5x7 bitmap + advance.
 
     static inline const Glyph& glyph(char c)
@@ -169,6 +190,9 @@ private:
             set(' ', { 0,0,0,0,0,0,0 }, 4);
             set('.', { 0,0,0,0,0,0b00110,0b00110 }, 3);
             set(':', { 0,0b00100,0b00100,0,0b00100,0b00100,0 }, 3);
+            set('-', { 0,0,0,0b01110,0,0,0 });
+            set('/', { 0b00001,0b00001,0b00010,0b00100,0b01000,0b10000,0b10000 });
+            set('%', { 0b11000,0b11001,0b00010,0b00100,0b01000,0b10011,0b00011 });
 
             //Digits.
             set('0', { 0b01110,0b10001,0b10011,0b10101,0b11001,0b10001,0b01110 });
@@ -182,17 +206,39 @@ private:
             set('8', { 0b01110,0b10001,0b10001,0b01110,0b10001,0b10001,0b01110 });
             set('9', { 0b01110,0b10001,0b10001,0b01111,0b00001,0b00010,0b01100 });
 
-            //Letters used.
+            //Letters (lowercase draws as uppercase).
+            set('A', { 0b01110,0b10001,0b10001,0b11111,0b10001,0b10001,0b10001 });
+            set('B', { 0b11110,0b10001,0b10001,0b11110,0b10001,0b10001,0b11110 });
+            set('C', { 0b01110,0b10001,0b10000,0b10000,0b10000,0b10001,0b01110 });
+            set('D', { 0b11110,0b10001,0b10001,0b10001,0b10001,0b10001,0b11110 });
+            set('E', { 0b11111,0b10000,0b10000,0b11110,0b10000,0b10000,0b11111 });
             set('F', { 0b11111,0b10000,0b11100,0b10000,0b10000,0b10000,0b10000 });
+            set('G', { 0b01110,0b10001,0b10000,0b10111,0b10001,0b10001,0b01111 });
+            set('H', { 0b10001,0b10001,0b10001,0b11111,0b10001,0b10001,0b10001 });
+            set('I', { 0b11111,0b00100,0b00100,0b00100,0b00100,0b00100,0b11111 });
+            set('J', { 0b00111,0b00010,0b00010,0b00010,0b00010,0b10010,0b01100 });
+            set('K', { 0b10001,0b10010,0b10100,0b11000,0b10100,0b10010,0b10001 });
+            set('L', { 0b10000,0b10000,0b10000,0b10000,0b10000,0b10000,0b11111 });
+            set('M', { 0b10001,0b11011,0b10101,0b10101,0b10001,0b10001,0b10001 });
+            set('N', { 0b10001,0b10001,0b11001,0b10101,0b10011,0b10001,0b10001 });
+            set('O', { 0b01110,0b10001,0b10001,0b10001,0b10001,0b10001,0b01110 });
             set('P', { 0b11110,0b10001,0b10001,0b11110,0b10000,0b10000,0b10000 });
+            set('Q', { 0b01110,0b10001,0b10001,0b10001,0b10101,0b10010,0b01101 });
+            set('R', { 0b11110,0b10001,0b10001,0b11110,0b10100,0b10010,0b10001 });
             set('S', { 0b01111,0b10000,0b10000,0b01110,0b00001,0b00001,0b11110 });
+            set('T', { 0b11111,0b00100,0b00100,0b00100,0b00100,0b00100,0b00100 });
+            set('U', { 0b10001,0b10001,0b10001,0b10001,0b10001,0b10001,0b01110 });
             set('V', { 0b10001,0b10001,0b10001,0b10001,0b01010,0b01010,0b00100 });
-            set('I', { 0b11111,0b00100,0b00100,0b00100,0b00100,0b00100,0b11111 });
+            set('W', { 0b10001,0b10001,0b10001,0b10101,0b10101,0b10101,0b01010 });
+            set('X', { 0b10001,0b10001,0b01010,0b00100,0b01010,0b10001,0b10001 });
+            set('Y', { 0b10001,0b10001,0b01010,0b00100,0b00100,0b00100,0b00100 });
+            set('Z', { 0b11111,0b00001,0b00010,0b00100,0b01000,0b10000,0b11111 });
 
             init = true;
         }
 
-        return G[(int)c];
+        if (c >= 'a' && c <= 'z') c = char(c - 'a' + 'A');
+        return G[(int)(unsigned char)c & 127];
     }
 
     static inline void appendText(std::vector<HUDRect>& out, int x, int y, int scale, int charSpacing,
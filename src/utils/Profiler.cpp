@@ -0,0 +1,258 @@
+/*
+    Scoped CPU profiler implementation: ring registry, per-frame aggregation, trace_event writer.
+*/
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//--PROFILER-STATE--
+namespace
+{
+    struct Ring
+    {
+        std::unique_ptr<Profiler::Event[]> events{ new Profiler::Event[Profiler::RING_CAPACITY] };
+        std::atomic<std::uint64_t> head{ 0 };   //Events ever written; slot = head % RING_CAPACITY.
+        std::uint64_t readHead = 0;             //Events already folded by endFrame.
+        std::string name;                       //Trace lane name.
+        double busyMs = 0.0;                    //Rolling top-level scope time per frame (workers).
+        bool ranWork = false;                   //Ever recorded a chunk or a stage.
+    };
+
+    struct NameStat
+    {
+        const char* name = nullptr;
+        double frameMs = 0.0;                   //Accumulated this frame.
+        double averageMs = 0.0;                 //Rolling.
+    };
+
+    struct GroupStat
+    {
+        double maxMs = 0.0, sumMs = 0.0;
+        int count = 0;
+    };
+
+    struct ProfilerState
+    {
+        std::mutex mutex;                       //Guards the registry and the rolling stats, never the recording path.
+        std::vector<std::unique_ptr<Ring>> rings;
+        Ring* frameRing = nullptr;              //Thread that calls endFrame.
+        NameStat names[Profiler::MAX_NAMES];
+        int nameCount = 0;
+        double imbalance = 1.0;
+        std::unordered_map<std::uint32_t, GroupStat> groups; //Per parallelFor call, reused every frame.
+    };
+
+    const double SMOOTHING = 0.1;               //Weight of the newest frame in the rolling averages.
+    const std::uint64_t RING_MASK = Profiler::RING_CAPACITY - 1;
+
+    //Never destroyed: worker threads of a global ThreadSystem may outlive static destruction order.
+    ProfilerState& state()
+    {
+        static ProfilerState* s = new ProfilerState();
+        return *s;
+    }
+
+    thread_local Ring* localRing = nullptr;
+
+    Ring& threadRing()
+    {
+        if (!localRing)
+        {
+            ProfilerState& s = state();
+            std::lock_guard<std::mutex> lk(s.mutex);
+
+            s.rings.push_back(std::make_unique<Ring>());
+            localRing = s.rings.back().get();
+            localRing->name = "thread " + std::to_string(s.rings.size() - 1);
+        }
+
+        return *localRing;
+    }
+
+    double durationMs(const Profiler::Event& e) { return double(e.end - e.begin) * 1e-6; }
+}
+//--PROFILER-STATE-END--
+
+void Profiler::setThreadName(const char* prefix, int index)
+{
+    Ring& ring = threadRing();
+
+    std::lock_guard<std::mutex> lk(state().mutex);
+    ring.name = index >= 0 ? std::string(prefix) + " " + std::to_string(index) : std::string(prefix);
+}
+
+void Profiler::record(const Event& e)
+{
+    Ring& ring = threadRing();
+
+    const std::uint64_t h = ring.head.load(std::memory_order_relaxed); //Single writer.
+    ring.events[h & RING_MASK] = e;
+    ring.head.store(h + 1, std::memory_order_release);                  //Publish after the slot is written.
+}
+
+void Profiler::endFrame()
+{
+    Ring& frame = threadRing();
+    ProfilerState& s = state();
+
+    std::lock_guard<std::mutex> lk(s.mutex);
+    s.frameRing = &frame;
+    s.groups.clear();
+
+    for (const std::unique_ptr<Ring>& owned : s.rings)
+    {
+        Ring& ring = *owned;
+        const std::uint64_t h = ring.head.load(std::memory_order_acquire);
+        const std::uint64_t from = std::max(ring.readHead, h > RING_CAPACITY ? h - RING_CAPACITY : 0);
+        double busy = 0.0;
+
+        for (std::uint64_t i = from; i < h; ++i)
+        {
+            const Event& e = ring.events[i & RING_MASK];
+            const double ms = durationMs(e);
+
+            if (e.depth == 0) busy += ms; //Stolen chunks and task graph stages; nested scopes are inside them.
+
+            if (e.group != 0)
+            {
+                //--CHUNK-TOTALS-- (per parallelFor call; the frame thread runs chunks too)
+                GroupStat& g = s.groups[e.group];
+                g.maxMs = std::max(g.maxMs, ms);
+                g.sumMs += ms;
+                ++g.count;
+                //--CHUNK-TOTALS-END--
+            }
+            else
+            {
+                //--STAGE-TOTALS-- (every plain scope on any thread, keyed by its literal: task graph stages run on workers)
+                int slot = 0;
+                while (slot < s.nameCount && s.names[slot].name != e.name && std::strcmp(s.names[slot].name, e.name) != 0) ++slot;
+
+                if (slot == s.nameCount)
+                {
+                    if (s.nameCount == MAX_NAMES) continue;
+                    s.names[s.nameCount++].name = e.name;
+                }
+
+                s.names[slot].frameMs += ms;
+                //--STAGE-TOTALS-END--
+            }
+        }
+
+        ring.readHead = h;
+
+        if (&ring != &frame)
+        {
+            ring.ranWork = ring.ranWork || busy > 0.0;
+            ring.busyMs += SMOOTHING * (busy - ring.busyMs);
+        }
+    }
+
+    for (int k = 0; k < s.nameCount; ++k)
+    {
+        s.names[k].averageMs += SMOOTHING * (s.names[k].frameMs - s.names[k].averageMs);
+        s.names[k].frameMs = 0.0;
+    }
+
+    //--IMBALANCE-- (time-weighted: long calls count more than the many tiny ones)
+    double slowest = 0.0, even = 0.0;
+    for (const auto& [group, g] : s.groups)
+    {
+        if (g.count < 2) continue; //A single chunk cannot be uneven.
+        slowest += g.maxMs;
+        even += g.sumMs / g.count;
+    }
+
+    if (even > 0.0) s.imbalance += SMOOTHING * (slowest / even - s.imbalance);
+    //--IMBALANCE-END--
+}
+
+double Profiler::getAverageMs(const char* name)
+{
+    ProfilerState& s = state();
+    std::lock_guard<std::mutex> lk(s.mutex);
+
+    for (int k = 0; k < s.nameCount; ++k)
+    {
+        if (s.names[k].name == name || std::strcmp(s.names[k].name, name) == 0) return s.names[k].averageMs;
+    }
+
+    return 0.0;
+}
+
+int Profiler::getWorkerCount()
+{
+    ProfilerState& s = state();
+    std::lock_guard<std::mutex> lk(s.mutex);
+
+    int count = 0;
+    for (const std::unique_ptr<Ring>& ring : s.rings) count += (ring.get() != s.frameRing && ring->ranWork) ? 1 : 0;
+    return count;
+}
+
+double Profiler::getWorkerBusyMs(int worker)
+{
+    ProfilerState& s = state();
+    std::lock_guard<std::mutex> lk(s.mutex);
+
+    for (const std::unique_ptr<Ring>& ring : s.rings)
+    {
+        if (ring.get() == s.frameRing || !ring->ranWork) continue;
+        if (worker-- == 0) return ring->busyMs;
+    }
+
+    return 0.0;
+}
+
+double Profiler::getImbalance()
+{
+    ProfilerState& s = state();
+    std::lock_guard<std::mutex> lk(s.mutex);
+    return s.imbalance;
+}
+
+bool Profiler::writeChromeTrace(const char* path)
+{
+    ProfilerState& s = state();
+    std::lock_guard<std::mutex> lk(s.mutex);
+
+    std::FILE* f = std::fopen(path, "w");
+    if (!f) return false;
+
+    std::fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+
+    for (size_t tid = 0; tid < s.rings.size(); ++tid)
+    {
+        const Ring& ring = *s.rings[tid];
+        const std::uint64_t h = ring.head.load(std::memory_order_acquire);
+
+        std::fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"%s\"}}",
+                     first ? "" : ",\n", tid, ring.name.c_str());
+        std::fprintf(f, ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"sort_index\":%d}}",
+                     tid, &ring == s.frameRing ? -1 : int(tid)); //Frame thread on top.
+        first = false;
+
+        for (std::uint64_t i = (h > RING_CAPACITY ? h - RING_CAPACITY : 0); i < h; ++i)
+        {
+            const Event& e = ring.events[i & RING_MASK];
+
+            std::fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f",
+                         e.name, tid, double(e.begin) * 1e-3, double(e.end - e.begin) * 1e-3);
+
+            if (e.group != 0) std::fprintf(f, ",\"args\":{\"call\":%u,\"chunk\":%d}}", e.group, int(e.chunk));
+            else std::fprintf(f, "}");
+        }
+    }
+
+    std::fprintf(f, "\n]}\n");
+    return std::fclose(f) == 0;
+}
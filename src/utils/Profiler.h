@@ -0,0 +1,106 @@
+/*
+    Scoped CPU profiler header: per-thread event rings, rolling per-stage averages, Chrome trace export.
+*/
+
+#pragma once
+
+#include "../app/AppConfig.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+//Every PROFILE_SCOPE writes one event (name, begin, end) into a ring owned by the thread that ran it, so
+//recording takes no lock: the ring has a single writer and publishes its head with a release store.
+//ThreadSystem tags each parallelFor chunk with the scope that issued it, which puts per-worker chunk
+//times next to the main-thread stages in the trace and feeds the imbalance readout. Stage totals sum a
+//scope over every thread, since task graph stages run wherever a lane picks them up.
+//
+//Rings are read (endFrame, writeChromeTrace) on the frame thread between parallel sections: parallelFor and
+//TaskGraph::run block until every event is published, so workers are idle then. Each ring keeps the last
+//RING_CAPACITY events, older ones are overwritten.
+//
+//With PROFILING 0 the macros expand to nothing and the class is never touched.
+class Profiler
+{
+public:
+    static constexpr int RING_CAPACITY = 1 << 15; //Events per thread (32 B each).
+    static constexpr int MAX_NAMES = 64;         //Distinct scope names tracked for the rolling readout.
+
+    struct Event
+    {
+        const char* name;           //String literal, compared by pointer first.
+        std::uint64_t begin, end;   //Nanoseconds since profiler start.
+        std::uint32_t group;        //parallelFor call id for chunk events, 0 otherwise.
+        std::int16_t chunk;         //Chunk index, -1 for plain scopes.
+        std::int16_t depth;         //Nesting depth on the recording thread.
+    };
+
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name, std::uint32_t group = 0, int chunk = -1)
+            : name(name), group(group), chunk(chunk), parent(current), begin(now())
+        {
+            current = name;
+            depth = openDepth++;
+        }
+
+        ~Scope()
+        {
+            record(Event{ name, begin, now(), group, static_cast<std::int16_t>(chunk), static_cast<std::int16_t>(depth) });
+            current = parent;
+            --openDepth;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* name;
+        std::uint32_t group;
+        int chunk;
+        const char* parent;
+        int depth = 0;
+        std::uint64_t begin;
+    };
+
+    static std::uint64_t now()
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+    }
+
+    static const char* currentScope() { return current ? current : "parallelFor"; } //Innermost open scope on this thread.
+    static std::uint32_t nextGroup() { return groupCounter.fetch_add(1, std::memory_order_relaxed) + 1; }
+
+    static void setThreadName(const char* prefix, int index = -1); //Name the calling thread's trace lane ("worker 3").
+    static void record(const Event& e);                            //Append to the calling thread's ring.
+
+    //Fold the events since the last call into the rolling averages. Call once per frame from the frame thread.
+    static void endFrame();
+
+    static double getAverageMs(const char* name);   //Rolling per-frame time of a scope summed over threads, 0 if never seen.
+    static int getWorkerCount();                    //Threads other than the frame thread that recorded anything.
+    static double getWorkerBusyMs(int worker);      //Rolling per-frame time of one worker inside chunks and stages.
+    static double getImbalance();                   //Rolling slowest / average chunk time per parallelFor, 1 = even.
+
+    static bool writeChromeTrace(const char* path); //trace_event JSON of everything still in the rings.
+
+private:
+    static inline const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    static inline std::atomic<std::uint32_t> groupCounter{ 0 };
+    static inline thread_local const char* current = nullptr;
+    static inline thread_local int openDepth = 0;
+};
+
+#if PROFILING
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) Profiler::Scope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_CHUNK(name, group, chunk) Profiler::Scope PROFILE_CONCAT(profileChunk, __LINE__)(name, group, chunk)
+#define PROFILE_THREAD_NAME(prefix, index) Profiler::setThreadName(prefix, index)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_CHUNK(name, group, chunk)
+#define PROFILE_THREAD_NAME(prefix, index)
+#endif